@@ -0,0 +1,29 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <fmt/core.h>
+#include <string_view>
+
+namespace naivedb {
+/**
+ * @brief Run f() for the given number of iterations and print the average latency of each iteration.
+ *
+ * @tparam F
+ * @param name
+ * @param iterations
+ * @param f
+ * @return double the average latency in nanoseconds
+ */
+template <typename F>
+double run_benchmark(std::string_view name, size_t iterations, F &&f) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        f(i);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    auto latency = elapsed.count() / iterations;
+    fmt::print("{:<40} {:>10.1f} ns/op\n", name, latency);
+    return latency;
+}
+}  // namespace naivedb
@@ -0,0 +1,157 @@
+#include "benchmark_utils.h"
+#include "buffer/buffer_manager.h"
+#include "common/constants.h"
+#include "common/task_queue.h"
+#include "common/types.h"
+#include "io/disk_manager.h"
+#include "io/memory_storage.h"
+#include "storage/page/page_guard.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <vector>
+
+using namespace naivedb;
+
+constexpr size_t POOL_SIZE = 1024;
+constexpr size_t PARTITIONS = 16;
+constexpr size_t ITERATIONS = 2000000;
+constexpr size_t MISS_PAGES = 8 * POOL_SIZE;
+
+constexpr size_t SCAN_PAGES = 4096;
+constexpr size_t SCAN_POOL_SIZE = 256;
+
+void benchmark_hits(std::string_view policy_name, buffer::ReplacementPolicy policy, size_t threads) {
+    // the pages are kept in memory, since only hits are measured
+    io::MemoryStorage storage;
+    buffer::BufferManager bm(POOL_SIZE, &storage, PARTITIONS, policy);
+
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < POOL_SIZE; ++i) {
+        page_ids.emplace_back(bm.new_page()->page_id());
+    }
+    std::mt19937 rng(0);
+    std::vector<page_id_t> random_page_ids(ITERATIONS);
+    for (auto &page_id : random_page_ids) {
+        page_id = page_ids[rng() % page_ids.size()];
+    }
+
+    fmt::print(
+        "fetch_page hit latency ({} replacer, pool size {}, {} partitions)\n", policy_name, POOL_SIZE, PARTITIONS);
+    run_benchmark("same page", ITERATIONS, [&](size_t) { bm.fetch_page(page_ids[0]); });
+    run_benchmark("random resident page", ITERATIONS, [&](size_t i) { bm.fetch_page(random_page_ids[i]); });
+    {
+        // the page stays pinned, so the unpin of each iteration never makes the frame evictable
+        auto pinned = bm.fetch_page(page_ids[0]);
+        run_benchmark("same page, already pinned", ITERATIONS, [&](size_t) { bm.fetch_page(page_ids[0]); });
+    }
+
+    TaskQueue tasks;
+    for (size_t t = 0; t < threads; ++t) {
+        tasks.push([&, t]() {
+            for (size_t i = 0; i < ITERATIONS; ++i) {
+                bm.fetch_page(random_page_ids[(i + t * ITERATIONS / threads) % ITERATIONS]);
+            }
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    tasks.wait();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    fmt::print("{:<40} {:>10.0f} fetches/s\n",
+               fmt::format("random resident page, {} threads", threads),
+               threads * ITERATIONS / elapsed.count());
+}
+
+/**
+ * @brief Fetch random pages of a table several times larger than the pool, which is kept in memory, so that the CPU
+ * cost of the misses is measured without the cost of the I/O.
+ *
+ */
+void benchmark_misses() {
+    io::MemoryStorage storage;
+    buffer::BufferManager bm(POOL_SIZE, &storage, PARTITIONS);
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < MISS_PAGES; ++i) {
+        page_ids.emplace_back(bm.new_page()->page_id());
+    }
+    std::mt19937 rng(0);
+    std::vector<page_id_t> random_page_ids(ITERATIONS);
+    for (auto &page_id : random_page_ids) {
+        page_id = page_ids[rng() % page_ids.size()];
+    }
+    fmt::print("fetch_page miss latency (in-memory storage, pool size {}, {} pages)\n", POOL_SIZE, MISS_PAGES);
+    run_benchmark("random page", ITERATIONS, [&](size_t i) { bm.fetch_page(random_page_ids[i]); });
+    fmt::print("{}\n", bm.stats());
+}
+
+void benchmark_cold_scan(io::Storage &storage, std::string_view storage_name, size_t read_ahead) {
+    std::vector<page_id_t> page_ids;
+    {
+        buffer::BufferManager bm(SCAN_POOL_SIZE, &storage);
+        for (size_t i = 0; i < SCAN_PAGES; ++i) {
+            page_ids.emplace_back(bm.new_page()->page_id());
+        }
+    }
+
+    // a fresh buffer manager, so that every page of the scan misses
+    buffer::BufferManager bm(SCAN_POOL_SIZE, &storage);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < SCAN_PAGES; ++i) {
+        if (read_ahead > 0 && i + read_ahead < SCAN_PAGES) {
+            bm.prefetch({page_ids[i + read_ahead]});
+        }
+        bm.fetch_page(page_ids[i]);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    fmt::print("{:<40} {:>10.1f} MB/s\n",
+               fmt::format("cold scan, {}, read-ahead {} pages", storage_name, read_ahead),
+               SCAN_PAGES * PAGE_SIZE / elapsed.count() / 1e6);
+}
+
+void benchmark_flush() {
+    remove("benchmark.db");
+    io::DiskManager dm("benchmark.db");
+    buffer::BufferManager bm(POOL_SIZE, &dm, PARTITIONS);
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < POOL_SIZE; ++i) {
+        page_ids.emplace_back(bm.new_page()->page_id());
+    }
+    bm.flush_all_pages();
+    for (auto page_id : page_ids) {
+        bm.fetch_page(page_id)->data_mut();
+    }
+    auto start = std::chrono::steady_clock::now();
+    bm.flush_all_pages();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    fmt::print("{:<40} {:>10.1f} MB/s\n",
+               fmt::format("flush_all_pages, {} dirty pages", POOL_SIZE),
+               POOL_SIZE * PAGE_SIZE / elapsed.count() / 1e6);
+    remove("benchmark.db");
+}
+
+int main(int argc, char *argv[]) {
+    size_t threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+    benchmark_hits("LRU", buffer::ReplacementPolicy::Lru, threads);
+    benchmark_hits("CLOCK", buffer::ReplacementPolicy::Clock, threads);
+    benchmark_misses();
+    benchmark_flush();
+    fmt::print("cold sequential scan ({} pages, pool size {})\n", SCAN_PAGES, SCAN_POOL_SIZE);
+    for (auto backend : {io::IoBackend::Sync, io::IoBackend::IoUring}) {
+        for (size_t read_ahead : {0, 8, 32}) {
+            remove("benchmark.db");
+            io::DiskManager dm("benchmark.db", backend);
+            benchmark_cold_scan(dm, dm.backend() == io::IoBackend::IoUring ? "io_uring" : "sync", read_ahead);
+            remove("benchmark.db");
+        }
+    }
+    for (size_t read_ahead : {0, 8, 32}) {
+        // a device with the latency of a fast SSD
+        io::MemoryStorage storage({std::chrono::microseconds(100), 0});
+        benchmark_cold_scan(storage, "memory, 100us latency", read_ahead);
+    }
+    return EXIT_SUCCESS;
+}
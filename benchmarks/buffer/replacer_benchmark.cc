@@ -0,0 +1,101 @@
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "buffer/replacer.h"
+#include "common/constants.h"
+#include "common/types.h"
+
+#include <cstdlib>
+#include <fmt/core.h>
+#include <memory>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace naivedb;
+
+constexpr size_t POOL_SIZE = 1024;
+constexpr size_t HOT_PAGES = 768;
+constexpr size_t SCAN_PAGES = 8192;
+constexpr size_t TUPLES_PER_PAGE = 4;
+constexpr size_t TRACE_LENGTH = 2000000;
+
+/**
+ * @brief Generate a trace of point lookups on a hot set interleaved with sequential scans. The scans read every page
+ * of a table much larger than the pool once per tuple, so each scanned page is accessed a few times in a row.
+ *
+ * @param scan_ratio the fraction of accesses issued by the scans
+ * @return std::vector<page_id_t>
+ */
+std::vector<page_id_t> make_trace(double scan_ratio) {
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<double> coin(0, 1);
+    std::vector<page_id_t> trace;
+    trace.reserve(TRACE_LENGTH);
+    size_t next_scan_tuple = 0;
+    for (size_t i = 0; i < TRACE_LENGTH; ++i) {
+        if (coin(rng) < scan_ratio) {
+            trace.emplace_back(HOT_PAGES + next_scan_tuple / TUPLES_PER_PAGE);
+            next_scan_tuple = (next_scan_tuple + 1) % (SCAN_PAGES * TUPLES_PER_PAGE);
+        } else {
+            trace.emplace_back(rng() % HOT_PAGES);
+        }
+    }
+    return trace;
+}
+
+/**
+ * @brief Replay the trace against a replacer the way BufferManager drives it: every access pins the frame and unpins it
+ * right away, and a miss takes a free frame or a victim.
+ *
+ * @return double the hit rate
+ */
+double replay(buffer::Replacer &replacer, const std::vector<page_id_t> &trace) {
+    std::unordered_map<page_id_t, frame_id_t> page_table;
+    std::vector<page_id_t> frames(POOL_SIZE, INVALID_PAGE_ID);
+    frame_id_t next_free_frame = 0;
+    size_t hits = 0;
+    for (auto page_id : trace) {
+        frame_id_t frame_id;
+        if (auto iter = page_table.find(page_id); iter != page_table.end()) {
+            ++hits;
+            frame_id = iter->second;
+            replacer.pin(frame_id);
+        } else {
+            if (next_free_frame < static_cast<frame_id_t>(POOL_SIZE)) {
+                frame_id = next_free_frame++;
+            } else {
+                frame_id = replacer.victim();
+                page_table.erase(frames[frame_id]);
+            }
+            frames[frame_id] = page_id;
+            page_table.emplace(page_id, frame_id);
+        }
+        replacer.unpin(frame_id);
+    }
+    return static_cast<double>(hits) / trace.size();
+}
+
+void benchmark_hit_rate(double scan_ratio) {
+    auto trace = make_trace(scan_ratio);
+    fmt::print("hit rate (pool size {}, {} hot pages, {} scanned pages, {:.0f}% scan accesses)\n",
+               POOL_SIZE,
+               HOT_PAGES,
+               SCAN_PAGES,
+               scan_ratio * 100);
+    auto report = [&](std::string_view name, std::unique_ptr<buffer::Replacer> replacer) {
+        fmt::print("{:<40} {:>9.2f}%\n", name, replay(*replacer, trace) * 100);
+    };
+    report("LRU", std::make_unique<buffer::LruReplacer>(POOL_SIZE));
+    report("CLOCK", std::make_unique<buffer::ClockReplacer>(POOL_SIZE, 0));
+    report("LRU-2, no correlated period", std::make_unique<buffer::LruKReplacer>(2, 0));
+    report("LRU-2, correlated period 16", std::make_unique<buffer::LruKReplacer>(2, 16));
+}
+
+int main() {
+    benchmark_hit_rate(0.1);
+    benchmark_hit_rate(0.3);
+    benchmark_hit_rate(0.5);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+#include "common/constants.h"
+#include "common/task_queue.h"
+#include "common/types.h"
+#include "io/compressed_storage.h"
+#include "io/disk_manager.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/core.h>
+#include <random>
+#include <string_view>
+#include <sys/stat.h>
+#include <vector>
+
+using namespace naivedb;
+
+constexpr size_t PAGES = 4096;
+constexpr size_t READS = 20000;
+constexpr size_t ALLOC_PAGES = 4096;
+constexpr size_t TABLE_PAGES = 4096;
+
+/**
+ * @brief Read random pages from several threads at once and print the throughput.
+ *
+ */
+void benchmark_random_reads(io::DiskManager &dm, const std::vector<page_id_t> &page_ids, size_t threads) {
+    std::mt19937 rng(0);
+    std::vector<page_id_t> random_page_ids(READS);
+    for (auto &page_id : random_page_ids) {
+        page_id = page_ids[rng() % page_ids.size()];
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    TaskQueue tasks;
+    for (size_t t = 0; t < threads; ++t) {
+        tasks.push([&, t]() {
+            alignas(PAGE_SIZE) char page[PAGE_SIZE];
+            for (size_t i = t; i < READS; i += threads) {
+                dm.read_page_aligned(random_page_ids[i], page);
+            }
+        });
+    }
+    tasks.wait();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    fmt::print("{:<40} {:>10.0f} reads/s\n",
+               fmt::format("{}, {} threads", dm.backend() == io::IoBackend::IoUring ? "io_uring" : "sync", threads),
+               READS / elapsed.count());
+}
+
+/**
+ * @brief Allocate pages one by one or in runs and print the throughput.
+ *
+ */
+void benchmark_alloc(size_t run_length) {
+    remove("benchmark.db");
+    io::DiskManager dm("benchmark.db");
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ALLOC_PAGES; i += run_length) {
+        if (run_length == 1) {
+            dm.alloc_page();
+        } else {
+            dm.alloc_pages(run_length);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    fmt::print("{:<40} {:>10.0f} pages/s\n",
+               run_length == 1 ? "alloc_page" : fmt::format("alloc_pages({})", run_length),
+               ALLOC_PAGES / elapsed.count());
+    remove("benchmark.db");
+}
+
+/**
+ * @brief Write and read pages like those of a table, with small integers and zero-padded strings, and print the
+ * throughput and the size of the file.
+ *
+ */
+void benchmark_table_pages(io::Storage &storage, std::string_view name, const char *file_name) {
+    std::mt19937 rng(0);
+    alignas(PAGE_SIZE) char page[PAGE_SIZE];
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < TABLE_PAGES; ++i) {
+        page_ids.emplace_back(storage.alloc_page());
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (auto page_id : page_ids) {
+        std::memset(page, 0, PAGE_SIZE);
+        for (size_t offset = 0; offset + 64 <= PAGE_SIZE; offset += 64) {
+            auto value = static_cast<int32_t>(rng() % 1000);
+            std::memcpy(page + offset, &value, sizeof(value));
+            for (size_t i = 0; i < rng() % 24; ++i) {
+                page[offset + 4 + i] = static_cast<char>('a' + rng() % 26);
+            }
+        }
+        storage.write_page_aligned(page_id, page);
+    }
+    std::chrono::duration<double> write_elapsed = std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    for (auto page_id : page_ids) {
+        storage.read_page_aligned(page_id, page);
+    }
+    std::chrono::duration<double> read_elapsed = std::chrono::steady_clock::now() - start;
+    struct stat buf;
+    stat(file_name, &buf);
+    fmt::print("{:<40} {:>10.1f} MB/s written, {:>8.1f} MB/s read, file {:.1f} MB\n",
+               name,
+               TABLE_PAGES * PAGE_SIZE / write_elapsed.count() / 1e6,
+               TABLE_PAGES * PAGE_SIZE / read_elapsed.count() / 1e6,
+               buf.st_size / 1e6);
+}
+
+int main() {
+    fmt::print("page allocation ({} pages)\n", ALLOC_PAGES);
+    for (size_t run_length : {1, 64}) {
+        benchmark_alloc(run_length);
+    }
+    fmt::print("random page reads ({} pages)\n", PAGES);
+    for (auto backend : {io::IoBackend::Sync, io::IoBackend::IoUring}) {
+        remove("benchmark.db");
+        io::DiskManager dm("benchmark.db", backend);
+        std::vector<page_id_t> page_ids;
+        for (size_t i = 0; i < PAGES; ++i) {
+            page_ids.emplace_back(dm.alloc_page());
+        }
+        for (size_t threads : {1, 4, 16}) {
+            benchmark_random_reads(dm, page_ids, threads);
+        }
+    }
+    fmt::print("table pages ({} pages)\n", TABLE_PAGES);
+    remove("benchmark.db");
+    {
+        io::DiskManager dm("benchmark.db");
+        benchmark_table_pages(dm, "uncompressed", "benchmark.db");
+    }
+    remove("benchmark.db");
+    {
+        io::CompressedStorage storage("benchmark.db");
+        benchmark_table_pages(storage, "compressed", "benchmark.db");
+    }
+    remove("benchmark.db");
+    remove("benchmark.db.map");
+    return EXIT_SUCCESS;
+}
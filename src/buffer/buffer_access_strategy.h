@@ -0,0 +1,107 @@
+#pragma once
+
+#include "common/types.h"
+
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <vector>
+
+namespace naivedb::buffer {
+/**
+ * @brief BufferAccessStrategy lets a large sequential scan recycle a small private ring of frames instead of streaming
+ * every page through the shared replacer.
+ *
+ * Pass the same strategy to every BufferManager::fetch_page() call of a scan. Until the ring is full, misses take
+ * frames from the pool as usual and remember them in the ring. After that, a miss reuses the oldest frame of the ring
+ * if it still holds the page the scan loaded into it and nobody has pinned it, so the scan evicts its own pages rather
+ * than the hot pages of other queries. Hits are not affected.
+ *
+ * Copies of a strategy share the same rings, so that the prefetches of a scan can use its ring after the scan has
+ * finished. The ring of a partition is only accessed with the latch of the partition held. A strategy must only be used
+ * with one buffer manager.
+ */
+class BufferAccessStrategy {
+  public:
+    static constexpr size_t DEFAULT_RING_SIZE = 32;
+
+    /**
+     * @brief Construct a new BufferAccessStrategy object.
+     *
+     * @param ring_size the number of frames the scan may occupy. It is split evenly among the partitions of the buffer
+     * pool, with at least one frame in each partition.
+     */
+    explicit BufferAccessStrategy(size_t ring_size = DEFAULT_RING_SIZE)
+        : ring_size_(ring_size), rings_(std::make_shared<Rings>()) {}
+
+    size_t ring_size() const { return ring_size_; }
+
+  private:
+    friend class BufferManager;
+
+    struct Slot {
+        frame_id_t frame_id_;
+        // the page loaded into the frame by the scan. If the frame holds another page now, it has left the ring.
+        page_id_t page_id_;
+    };
+
+    /**
+     * @brief The ring of a partition, since a frame can only cache the pages of its own partition.
+     *
+     */
+    class Ring {
+      public:
+        explicit Ring(size_t capacity) : capacity_(capacity), next_(0) {}
+
+        /**
+         * @brief Get the slot to be recycled by the next miss.
+         *
+         * @return const Slot* the oldest slot, or nullptr if the ring is not full yet
+         */
+        const Slot *candidate() const { return slots_.size() < capacity_ ? nullptr : &slots_[next_]; }
+
+        /**
+         * @brief Remember the frame a page has just been loaded into. It replaces the oldest slot once the ring is full.
+         *
+         * @param frame_id
+         * @param page_id
+         */
+        void record(frame_id_t frame_id, page_id_t page_id) {
+            if (slots_.size() < capacity_) {
+                slots_.push_back({frame_id, page_id});
+                return;
+            }
+            slots_[next_] = {frame_id, page_id};
+            next_ = (next_ + 1) % capacity_;
+        }
+
+      private:
+        size_t capacity_;
+        size_t next_;
+        std::vector<Slot> slots_;
+    };
+
+    /**
+     * @brief Get the ring of a partition. The rings are created on first use.
+     *
+     * @param partition_index
+     * @param num_partitions the number of partitions of the buffer manager
+     * @return Ring&
+     */
+    Ring &ring(size_t partition_index, size_t num_partitions) {
+        std::call_once(rings_->init_, [&]() {
+            size_t capacity = (ring_size_ + num_partitions - 1) / num_partitions;
+            rings_->rings_.assign(num_partitions, Ring(capacity > 0 ? capacity : 1));
+        });
+        return rings_->rings_[partition_index];
+    }
+
+    struct Rings {
+        std::once_flag init_;
+        std::vector<Ring> rings_;
+    };
+
+    size_t ring_size_;
+    std::shared_ptr<Rings> rings_;
+};
+}  // namespace naivedb::buffer
@@ -1,9 +1,13 @@
 #pragma once
 
+#include "buffer/optimistic_latch.h"
 #include "common/constants.h"
 #include "common/types.h"
 
-#include <shared_mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
 
 namespace naivedb::buffer {
 /**
@@ -12,29 +16,182 @@ namespace naivedb::buffer {
  */
 class BufferFrame {
   public:
-    BufferFrame() : page_id_(INVALID_PAGE_ID), pin_count_(0), dirty_(false) {}
+    BufferFrame()
+        : page_(nullptr)
+        , page_id_(INVALID_PAGE_ID)
+        , pin_state_(0)
+        , dirty_(false)
+        , dirty_epoch_(0)
+        , in_replacer_(false)
+        , referenced_(false)
+        , io_in_progress_(false) {}
 
-    uint32_t pin_count() const { return pin_count_; }
-    void pin() { ++pin_count_; }
-    void unpin() { --pin_count_; }
+    uint32_t pin_count() const { return pin_state_.load() & PIN_COUNT_MASK; }
+
+    /**
+     * @brief Pin the frame unconditionally. This must be called with the partition latch held.
+     *
+     */
+    void pin() { pin_state_.fetch_add(1); }
+
+    /**
+     * @brief Pin the frame unless it is locked for eviction. This is safe to call without any latch, but the caller
+     * has to check the page id afterwards since the frame may have been reassigned before it is pinned.
+     *
+     * @return true if the frame is pinned
+     */
+    bool try_pin() {
+        auto state = pin_state_.load();
+        do {
+            if (state & EVICTION_LOCK) {
+                return false;
+            }
+        } while (!pin_state_.compare_exchange_weak(state, state + 1));
+        return true;
+    }
+
+    /**
+     * @brief Unpin the frame.
+     *
+     * @return uint32_t the pin count after unpinning
+     */
+    uint32_t unpin() { return (pin_state_.fetch_sub(1) - 1) & PIN_COUNT_MASK; }
+
+    /**
+     * @brief Lock an unpinned frame for eviction, which makes try_pin() fail until unlock_for_eviction() is called.
+     *
+     * @return true if the frame is unpinned and now locked
+     */
+    bool try_lock_for_eviction() {
+        uint32_t expected = 0;
+        return pin_state_.compare_exchange_strong(expected, EVICTION_LOCK);
+    }
+
+    bool locked_for_eviction() const { return pin_state_.load() & EVICTION_LOCK; }
+
+    void unlock_for_eviction() { pin_state_.fetch_and(~EVICTION_LOCK); }
+
+    /**
+     * @brief Check whether the frame is tracked by the replacer of its partition. This is safe to call without any
+     * latch, but only changes under the partition latch. Whoever takes the frame out of the replacer clears it before
+     * locking the frame for eviction, so that a final unpin either sees it cleared or lets the frame be locked.
+     *
+     * @return true if the frame is in the replacer
+     */
+    bool in_replacer() const { return in_replacer_.load(); }
+    void set_in_replacer(bool in_replacer) { in_replacer_.store(in_replacer); }
+
+    /**
+     * @brief Record a hit on a frame which is still in the replacer, so that the replacer can count it when it next
+     * considers the frame as a victim.
+     *
+     */
+    void set_referenced() { referenced_.store(true); }
+
+    bool referenced() const { return referenced_.load(); }
+
+    /**
+     * @brief Clear the reference bit.
+     *
+     * @return true if the frame has been referenced since the bit was last cleared
+     */
+    bool clear_referenced() { return referenced_.load() && referenced_.exchange(false); }
 
     char *page() { return page_; }
 
-    page_id_t page_id() const { return page_id_; }
-    void set_page_id(page_id_t page_id) { page_id_ = page_id; }
+    /**
+     * @brief Set the memory of the page, which is owned by the buffer manager and aligned to PAGE_SIZE.
+     *
+     * @param page
+     */
+    void set_page(char *page) { page_ = page; }
 
-    bool dirty() const { return dirty_; }
-    void set_dirty(bool dirty) { dirty_ = dirty; }
+    page_id_t page_id() const { return page_id_.load(); }
+    void set_page_id(page_id_t page_id) { page_id_.store(page_id); }
 
-    std::shared_mutex &rwlatch() { return rwlatch_; }
+    bool dirty() const { return dirty_.load(); }
+    void set_dirty(bool dirty) { dirty_.store(dirty); }
+
+    /**
+     * @brief Mark the frame as dirty. If it was clean, remember the checkpoint epoch in which it became dirty. This
+     * only loads the flag if the frame is dirty already.
+     *
+     * @param epoch
+     */
+    void mark_dirty(uint64_t epoch) {
+        if (!dirty_.load() && !dirty_.exchange(true)) {
+            dirty_epoch_.store(epoch);
+        }
+    }
+
+    /**
+     * @brief Get the checkpoint epoch in which the frame last became dirty.
+     *
+     * @return uint64_t
+     */
+    uint64_t dirty_epoch() const { return dirty_epoch_.load(); }
+
+    /**
+     * @brief Get the latch of the page, which readers may also skip by reading optimistically.
+     *
+     * @return OptimisticLatch&
+     */
+    OptimisticLatch &rwlatch() { return rwlatch_; }
+
+    /**
+     * @brief Check whether the page in the frame is being read from or written to disk.
+     *
+     * @return true
+     * @return false
+     */
+    bool io_in_progress() const { return io_in_progress_.load(); }
+
+    /**
+     * @brief Mark the frame as being read from or written to disk. Other threads interested in the page should call
+     * wait_io() before touching it.
+     *
+     */
+    void start_io() { io_in_progress_.store(true); }
+
+    /**
+     * @brief Clear the I/O state and wake up all the threads waiting on this frame.
+     *
+     */
+    void finish_io() {
+        {
+            std::scoped_lock latch(io_latch_);
+            io_in_progress_.store(false);
+        }
+        io_cv_.notify_all();
+    }
+
+    /**
+     * @brief Block the current thread until the I/O on this frame finishes.
+     *
+     */
+    void wait_io() {
+        std::unique_lock latch(io_latch_);
+        io_cv_.wait(latch, [this]() { return !io_in_progress_.load(); });
+    }
 
   private:
-    char page_[PAGE_SIZE];
+    static constexpr uint32_t EVICTION_LOCK = 1u << 31;
+    static constexpr uint32_t PIN_COUNT_MASK = EVICTION_LOCK - 1;
+
+    char *page_;
+
+    std::atomic<page_id_t> page_id_;
+    // the pin count in the lower bits, and the eviction lock in the highest bit
+    std::atomic<uint32_t> pin_state_;
+    std::atomic<bool> dirty_;
+    std::atomic<uint64_t> dirty_epoch_;
+    std::atomic<bool> in_replacer_;
+    std::atomic<bool> referenced_;
 
-    page_id_t page_id_;
-    uint32_t pin_count_;
-    bool dirty_;
+    OptimisticLatch rwlatch_;
 
-    std::shared_mutex rwlatch_;
+    std::atomic<bool> io_in_progress_;
+    std::mutex io_latch_;
+    std::condition_variable io_cv_;
 };
-}  // namespace naivedb::buffer
\ No newline at end of file
+}  // namespace naivedb::buffer
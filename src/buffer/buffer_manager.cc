@@ -1,149 +1,1058 @@
 #include "buffer/buffer_manager.h"
 
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
 #include "buffer/lru_replacer.h"
+#include "common/macros.h"
 #include "common/constants.h"
+#include "common/exception.h"
+#include "common/format.h"
 #include "common/types.h"
-#include "io/disk_manager.h"
+#include "io/storage.h"
 #include "storage/page/page_guard.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
+#include <fcntl.h>
 #include <mutex>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
 
 namespace naivedb::buffer {
-BufferManager::BufferManager(size_t pool_size, io::DiskManager *disk_manager)
-    : pool_size_(pool_size)
-    , frames_(std::make_unique<BufferFrame[]>(pool_size))
-    , replacer_(std::make_unique<LruReplacer>())
-    , disk_manager_(disk_manager) {
-    for (size_t i = 0; i < pool_size; ++i) {
-        free_list_.emplace_back(i);
+namespace {
+/**
+ * @brief Get the number of frames of a partition when the frames are spread evenly over the partitions.
+ *
+ */
+size_t partition_size(size_t pool_size, size_t num_partitions, size_t partition_index) {
+    return pool_size / num_partitions + (partition_index < pool_size % num_partitions ? 1 : 0);
+}
+
+void read_or_write_all(int fd, char *data, size_t size, bool write) {
+    while (size > 0) {
+        auto transferred = write ? ::write(fd, data, size) : ::read(fd, data, size);
+        if (transferred < 0 && errno == EINTR) {
+            continue;
+        }
+        if (transferred <= 0) {
+            throw IOException(fmt::format("I/O error {} {} bytes", write ? "writing" : "reading", size));
+        }
+        data += transferred;
+        size -= transferred;
+    }
+}
+}  // namespace
+
+BufferManager::BufferManager(size_t pool_size, io::Storage *storage, size_t num_partitions, ReplacementPolicy policy)
+    : pool_size_(0)
+    , num_partitions_(num_partitions)
+    , frame_directory_(nullptr)
+    , frame_directory_capacity_(0)
+    , num_frames_(0)
+    , partitions_(std::make_unique<Partition[]>(num_partitions))
+    , storage_(storage)
+    , checkpoint_epoch_(1)
+    , last_checkpoint_(0)
+    , stop_background_writer_(false)
+    , stop_prefetchers_(false)
+    , stop_reloader_(false)
+    , reloaded_pages_(0) {
+    assert(num_partitions > 0);
+    for (size_t i = 0; i < num_partitions; ++i) {
+        auto &partition = partitions_[i];
+        auto size = partition_size(pool_size, num_partitions, i);
+        partition.page_tables_.emplace_back(std::make_unique<PageTable>(size));
+        partition.page_table_.store(partition.page_tables_.back().get());
+        partition.replacer_ = make_replacer(policy, size, i, num_partitions);
+        partition.target_size_ = size;
+    }
+    // frame i goes to partition i % num_partitions, which gets exactly its share of the frames
+    add_frames(pool_size);
+}
+
+BufferManager::~BufferManager() {
+    stop_reloader_.store(true);
+    wait_reload();
+    {
+        std::scoped_lock latch(prefetch_latch_);
+        stop_prefetchers_ = true;
+    }
+    prefetch_cv_.notify_all();
+    for (auto &prefetcher : prefetchers_) {
+        prefetcher.join();
     }
+    stop_background_writer();
 }
 
-std::optional<storage::PageGuard> BufferManager::fetch_page(page_id_t page_id) {
-    std::scoped_lock latch(latch_);
-    if (auto iter = page_table_.find(page_id); iter != page_table_.end()) {
-        if (frames_[iter->second].pin_count() == 0) {
-            replacer_->pin(iter->second);
+std::optional<storage::PageGuard> BufferManager::fetch_page(page_id_t page_id, BufferAccessStrategy *strategy) {
+    auto &partition = partition_of(page_id);
+    // fast path for resident pages, which takes no latch
+    if (auto frame_id = partition.page_table().find(page_id); frame_id != INVALID_FRAME_ID) {
+        if (pin_resident_frame(frame_id, page_id)) {
+            stats_.add(StatsCollector::Hits);
+            return make_page_guard(frame_id);
         }
-        frames_[iter->second].pin();
-        return storage::PageGuard(frames_[iter->second].page(),
-                                  page_id,
-                                  &frames_[iter->second].rwlatch(),
-                                  [this, page_id](bool dirty) { unpin_page(page_id, dirty); });
     }
-    if (!disk_manager_->page_allocated(page_id)) {
-        return std::nullopt;
+
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock latch(partition.latch_);
+    while (true) {
+        if (auto frame_id = partition.page_table().find(page_id); frame_id != INVALID_FRAME_ID) {
+            auto &frame = get_frame(frame_id);
+            frame.pin();
+            latch.unlock();
+            // the page may still be being read or written back by another thread
+            if (frame.io_in_progress()) {
+                stats_.add(StatsCollector::PinWaits);
+                frame.wait_io();
+            }
+            if (frame.page_id() != page_id) {
+                // the other thread failed to read the page
+                unpin_frame(frame_id, false);
+                return std::nullopt;
+            }
+            stats_.add(StatsCollector::Hits);
+            return make_page_guard(frame_id);
+        }
+        auto frame_id = start_read(partition, latch, page_id, strategy);
+        if (frame_id == INVALID_FRAME_ID) {
+            if (partition.page_table().find(page_id) != INVALID_FRAME_ID) {
+                continue;
+            }
+            return std::nullopt;
+        }
+        latch.unlock();
+        try {
+            storage_->read_page_aligned(page_id, get_frame(frame_id).page());
+        } catch (...) {
+            finish_read(page_id, frame_id, false);
+            throw;
+        }
+        finish_read(page_id, frame_id, true);
+        stats_.add(StatsCollector::Misses);
+        stats_.record(StatsCollector::MissLatency, std::chrono::steady_clock::now() - start);
+        return make_page_guard(frame_id);
     }
-    auto frame_id = get_victim_frame();
+}
+
+std::optional<storage::PageGuard> BufferManager::try_fetch_page(page_id_t page_id) {
+    auto frame_id = partition_of(page_id).page_table().find(page_id);
     if (frame_id == INVALID_FRAME_ID) {
         return std::nullopt;
     }
-    auto &frame = frames_[frame_id];
-    if (frame.dirty()) {
-        disk_manager_->write_page(frame.page_id(), frame.page());
+    auto &frame = get_frame(frame_id);
+    if (!frame.try_pin()) {
+        return std::nullopt;
+    }
+    if (frame.page_id() != page_id || frame.io_in_progress()) {
+        unpin_frame(frame_id, false);
+        return std::nullopt;
+    }
+    stats_.add(StatsCollector::Probes);
+    return make_page_guard(frame_id);
+}
+
+void BufferManager::prefetch(const std::vector<page_id_t> &page_ids, const BufferAccessStrategy *strategy) {
+    std::scoped_lock latch(prefetch_latch_);
+    if (prefetchers_.empty()) {
+        for (size_t i = 0; i < PREFETCH_THREADS; ++i) {
+            prefetchers_.emplace_back([this]() { prefetcher(); });
+        }
+    }
+    for (auto page_id : page_ids) {
+        if (prefetch_requests_.size() == MAX_PREFETCH_REQUESTS) {
+            break;
+        }
+        if (partition_of(page_id).page_table().find(page_id) != INVALID_FRAME_ID) {
+            continue;
+        }
+        prefetch_requests_.push_back({page_id, strategy ? std::make_optional(*strategy) : std::nullopt});
+        prefetch_cv_.notify_one();
     }
-    reset_frame_metadata(frame_id, page_id);
-    disk_manager_->read_page(page_id, frame.page());
-    frame.pin();
-    return storage::PageGuard(
-        frame.page(), page_id, &frame.rwlatch(), [this, page_id](bool dirty) { unpin_page(page_id, dirty); });
 }
 
 std::optional<storage::PageGuard> BufferManager::new_page() {
-    std::scoped_lock latch(latch_);
-    auto page_id = disk_manager_->alloc_page();
-    auto frame_id = get_victim_frame();
+    // the partition depends on the page id, so the page has to be allocated before latching
+    auto page_id = storage_->alloc_page();
+    auto &partition = partition_of(page_id);
+    std::unique_lock latch(partition.latch_);
+    auto frame_id = get_victim_frame(partition, latch);
     if (frame_id == INVALID_FRAME_ID) {
-        disk_manager_->free_page(page_id);
+        latch.unlock();
+        storage_->free_page(page_id);
         return std::nullopt;
     }
-    auto &frame = frames_[frame_id];
-    if (frame.dirty()) {
-        disk_manager_->write_page(frame.page_id(), frame.page());
-    }
-    reset_frame_metadata(frame_id, page_id);
-    frame.pin();
+    auto &frame = get_frame(frame_id);
+    reset_frame_metadata(partition, frame_id, page_id);
     std::memset(frame.page(), 0, PAGE_SIZE);
-    return storage::PageGuard(
-        frame.page(), page_id, &frame.rwlatch(), [this, page_id](bool dirty) { unpin_page(page_id, dirty); });
+    frame.pin();
+    frame.unlock_for_eviction();
+    return make_page_guard(frame_id);
 }
 
 bool BufferManager::delete_page(page_id_t page_id) {
-    std::scoped_lock latch(latch_);
-    auto iter = page_table_.find(page_id);
-    if (iter != page_table_.end()) {
-        auto frame_id = iter->second;
-        auto &frame = frames_[frame_id];
+    auto &partition = partition_of(page_id);
+    std::unique_lock latch(partition.latch_);
+    while (true) {
+        auto frame_id = partition.page_table().find(page_id);
+        if (frame_id == INVALID_FRAME_ID) {
+            break;
+        }
+        auto &frame = get_frame(frame_id);
+        if (frame.try_lock_for_eviction()) {
+            // the frame goes back to the free list, so it must not be victimized by the replacer any more
+            partition.replacer_->pin(frame_id);
+            reset_frame_metadata(partition, frame_id, INVALID_PAGE_ID);
+            frame.unlock_for_eviction();
+            partition.free_list_.emplace_back(frame_id);
+            break;
+        }
         if (frame.pin_count() != 0) {
             return false;
         }
-        reset_frame_metadata(frame_id, INVALID_PAGE_ID);
-        free_list_.emplace_back(frame_id);
+        // the page is being written back by an eviction
+        latch.unlock();
+        frame.wait_io();
+        latch.lock();
     }
-    disk_manager_->free_page(page_id);
+    latch.unlock();
+    storage_->free_page(page_id);
     return true;
 }
 
 bool BufferManager::flush_page(page_id_t page_id) {
-    std::scoped_lock latch(latch_);
-    auto iter = page_table_.find(page_id);
-    if (iter == page_table_.end()) {
+    auto &partition = partition_of(page_id);
+    std::unique_lock latch(partition.latch_);
+    auto frame_id = partition.page_table().find(page_id);
+    if (frame_id == INVALID_FRAME_ID) {
         return false;
     }
-    auto frame_id = iter->second;
-    auto &frame = frames_[frame_id];
-    disk_manager_->write_page(page_id, frame.page());
-    frame.set_dirty(false);
+    auto &frame = get_frame(frame_id);
+    // pin the frame so that it cannot be evicted while the latch is released
+    frame.pin();
+    latch.unlock();
+    frame.wait_io();
+    if (frame.page_id() == page_id) {
+        // clear the dirty flag before writing, so that modifications made during the write are not lost
+        frame.set_dirty(false);
+        try {
+            storage_->write_page_aligned(page_id, frame.page());
+        } catch (...) {
+            unpin_frame(frame_id, true);
+            throw;
+        }
+    }
+    unpin_frame(frame_id, false);
     return true;
 }
 
 void BufferManager::flush_all_pages() {
-    std::scoped_lock latch(latch_);
-    for (auto [page_id, frame_id] : page_table_) {
-        auto &frame = frames_[frame_id];
-        disk_manager_->write_page(page_id, frame.page());
+    CheckpointProgress progress;
+    checkpoint({}, progress);
+}
+
+uint64_t BufferManager::checkpoint(const CheckpointOptions &options, CheckpointProgress &progress) {
+    std::scoped_lock checkpoint_latch(checkpoint_latch_);
+    // the pages that become dirty from now on belong to the next checkpoint
+    auto epoch = checkpoint_epoch_.fetch_add(1);
+    auto in_checkpoint = [epoch](BufferFrame &frame) { return frame.dirty() && frame.dirty_epoch() <= epoch; };
+
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < num_partitions_; ++i) {
+        auto &partition = partitions_[i];
+        std::scoped_lock latch(partition.latch_);
+        partition.page_table().for_each([&](page_id_t page_id, frame_id_t frame_id) {
+            if (in_checkpoint(get_frame(frame_id))) {
+                page_ids.emplace_back(page_id);
+            }
+        });
+    }
+    // adjacent pages belong to different partitions, so the pages of all the partitions are sorted together
+    std::sort(page_ids.begin(), page_ids.end());
+    progress.dirty_pages_ = page_ids.size();
+
+    std::chrono::nanoseconds interval(0);
+    if (options.max_pages_per_second_ > 0) {
+        interval = std::chrono::nanoseconds(std::chrono::seconds(1)) / options.max_pages_per_second_;
+    }
+    auto next_write_time = std::chrono::steady_clock::now();
+    std::vector<page_id_t> batch_page_ids;
+    std::vector<const char *> batch_pages_data;
+    // the frames of the batch, and whether each is locked for eviction rather than pinned
+    std::vector<std::pair<frame_id_t, bool>> batch_frames;
+    // the copies of the pinned pages of the batch, which are aligned for O_DIRECT
+    PageArena copies(FLUSH_BATCH_SIZE);
+    size_t batch_copies = 0;
+    auto write_batch = [&]() {
+        if (batch_page_ids.empty()) {
+            return;
+        }
+        bool written = false;
+        try {
+            storage_->write_pages(batch_page_ids, batch_pages_data);
+            written = true;
+        } catch (...) {
+            // the pages keep the epoch they became dirty in, so the next checkpoint writes them
+            for (auto [frame_id, _] : batch_frames) {
+                get_frame(frame_id).set_dirty(true);
+            }
+        }
+        for (size_t i = 0; i < batch_frames.size(); ++i) {
+            auto [frame_id, locked] = batch_frames[i];
+            auto &frame = get_frame(frame_id);
+            if (locked) {
+                std::scoped_lock latch(partition_of(batch_page_ids[i]).latch_);
+                frame.finish_io();
+                frame.unlock_for_eviction();
+            } else {
+                unpin_frame(frame_id, false);
+            }
+        }
+        if (!written) {
+            throw IOException(fmt::format("I/O error writing back {} pages for a checkpoint", batch_page_ids.size()));
+        }
+        progress.pages_written_ += batch_page_ids.size();
+        batch_page_ids.clear();
+        batch_pages_data.clear();
+        batch_frames.clear();
+        batch_copies = 0;
+    };
+    for (size_t begin = 0; begin < page_ids.size(); begin += FLUSH_BATCH_SIZE) {
+        auto end = std::min(begin + FLUSH_BATCH_SIZE, page_ids.size());
+        if (interval.count() > 0) {
+            std::this_thread::sleep_until(next_write_time);
+            next_write_time = std::max(next_write_time + interval * static_cast<int64_t>(end - begin),
+                                       std::chrono::steady_clock::now());
+        }
+        for (size_t i = begin; i < end; ++i) {
+            auto page_id = page_ids[i];
+            auto &partition = partition_of(page_id);
+            std::unique_lock latch(partition.latch_);
+            auto frame_id = partition.page_table().find(page_id);
+            if (frame_id == INVALID_FRAME_ID || !in_checkpoint(get_frame(frame_id))) {
+                ++progress.pages_skipped_;
+                continue;
+            }
+            auto &frame = get_frame(frame_id);
+            // an unpinned frame is locked like the background writer does, so that the write does not make it recently
+            // used, and nobody can modify it during the write
+            if (frame.try_lock_for_eviction()) {
+                frame.start_io();
+                frame.set_dirty(false);
+                batch_page_ids.emplace_back(page_id);
+                batch_pages_data.emplace_back(frame.page());
+                batch_frames.emplace_back(frame_id, true);
+                continue;
+            }
+            // a pinned frame may be modified by its guard during the write, so it is copied under the shared page
+            // latch. It is pinned once more until the write, and may be written back by an eviction before the copy.
+            frame.pin();
+            latch.unlock();
+            frame.wait_io();
+            if (frame.page_id() != page_id || !in_checkpoint(frame)) {
+                unpin_frame(frame_id, false);
+                ++progress.pages_skipped_;
+                continue;
+            }
+            std::shared_lock page_latch(frame.rwlatch(), std::try_to_lock);
+            if (!page_latch.owns_lock()) {
+                // the page latch holder may be waiting for a page locked by this batch, so the batch is written before
+                // waiting for the latch
+                write_batch();
+                page_latch.lock();
+            }
+            // the modifications made after the copy mark the frame dirty again, in the next checkpoint
+            frame.set_dirty(false);
+            std::memcpy(copies.page(batch_copies), frame.page(), PAGE_SIZE);
+            page_latch.unlock();
+            batch_page_ids.emplace_back(page_id);
+            batch_pages_data.emplace_back(copies.page(batch_copies++));
+            batch_frames.emplace_back(frame_id, false);
+        }
+        write_batch();
+        if (options.on_progress_) {
+            options.on_progress_(progress);
+        }
+    }
+    last_checkpoint_.store(epoch);
+    return epoch;
+}
+
+size_t BufferManager::resize(size_t new_size) {
+    assert(new_size >= num_partitions_);
+    std::scoped_lock resize_latch(resize_latch_);
+    size_t missing_frames = 0;
+    for (size_t i = 0; i < num_partitions_; ++i) {
+        auto &partition = partitions_[i];
+        std::scoped_lock latch(partition.latch_);
+        partition.target_size_ = partition_size(new_size, num_partitions_, i);
+        revive_frames(partition);
+        if (partition.size_ < partition.target_size_) {
+            missing_frames = std::max(missing_frames, partition.target_size_ - partition.size_);
+        }
+    }
+    // new frame ids are spread evenly over the partitions, so the partitions that need fewer keep the rest retired
+    if (missing_frames > 0) {
+        add_frames(missing_frames * num_partitions_);
+    }
+    retire_frames();
+    return size();
+}
+
+bool BufferManager::page_allocated(page_id_t page_id) { return storage_->page_allocated(page_id); }
+
+page_id_t BufferManager::lowest_free_page_id() { return storage_->lowest_free_page_id(); }
+
+size_t BufferManager::truncate_free_tail() { return storage_->truncate_free_tail(); }
+
+void BufferManager::start_background_writer(const BackgroundWriterOptions &options) {
+    assert(!background_writer_.joinable());
+    stop_background_writer_ = false;
+    background_writer_ = std::thread([this, options]() { background_writer(options); });
+}
+
+void BufferManager::stop_background_writer() {
+    if (!background_writer_.joinable()) {
+        return;
+    }
+    {
+        std::scoped_lock latch(background_writer_latch_);
+        stop_background_writer_ = true;
+    }
+    background_writer_cv_.notify_all();
+    background_writer_.join();
+}
+
+size_t BufferManager::clean_victim_candidates(double clean_fraction, size_t max_writes) {
+    size_t writes = 0;
+    for (size_t i = 0; i < num_partitions_ && writes < max_writes; ++i) {
+        auto &partition = partitions_[i];
+        std::vector<frame_id_t> frame_ids;
+        {
+            std::scoped_lock latch(partition.latch_);
+            auto count = static_cast<size_t>(partition.replacer_->size() * clean_fraction + 0.5);
+            // the referenced frames get a second chance, so they are only evicted after the others
+            auto candidates = partition.replacer_->candidates(partition.replacer_->size());
+            std::stable_partition(candidates.begin(), candidates.end(), [this](frame_id_t frame_id) {
+                return !get_frame(frame_id).referenced();
+            });
+            candidates.resize(std::min(count, candidates.size()));
+            for (auto frame_id : candidates) {
+                auto &frame = get_frame(frame_id);
+                if (frame.dirty() && frame.pin_count() == 0) {
+                    frame_ids.emplace_back(frame_id);
+                }
+            }
+        }
+        for (auto frame_id : frame_ids) {
+            if (writes == max_writes) {
+                break;
+            }
+            if (clean_frame(partition, frame_id)) {
+                ++writes;
+            }
+        }
+    }
+    stats_.add(StatsCollector::BackgroundWrites, writes);
+    return writes;
+}
+
+void BufferManager::unpin_frame(frame_id_t frame_id, bool dirty) {
+    auto &frame = get_frame(frame_id);
+    if (dirty) {
+        frame.mark_dirty(checkpoint_epoch_.load());
+    }
+    // a frame only holds pages of its own partition, so the partition can be found by the page id
+    auto page_id = frame.page_id();
+    if (frame.unpin() != 0 || page_id == INVALID_PAGE_ID) {
+        return;
+    }
+    // a frame pinned through the lock-free path has usually stayed in the replacer, which counts the access later
+    frame.set_referenced();
+    if (frame.in_replacer()) {
+        return;
+    }
+    auto &partition = partition_of(page_id);
+    std::scoped_lock latch(partition.latch_);
+    // the frame may have been pinned, evicted or freed before the latch is acquired
+    if (frame.page_id() != INVALID_PAGE_ID && frame.pin_count() == 0 && !frame.locked_for_eviction()) {
+        partition.replacer_->pin(frame_id);
+        partition.replacer_->unpin(frame_id);
+        frame.clear_referenced();
+        frame.set_in_replacer(true);
+    }
+}
+
+bool BufferManager::pin_resident_frame(frame_id_t frame_id, page_id_t page_id) {
+    auto &frame = get_frame(frame_id);
+    if (!frame.try_pin()) {
+        return false;
+    }
+    // the frame may have been reassigned between the lookup and the pin
+    if (frame.page_id() == page_id) {
+        if (!frame.io_in_progress()) {
+            return true;
+        }
+        stats_.add(StatsCollector::PinWaits);
+        frame.wait_io();
+        if (frame.page_id() == page_id) {
+            return true;
+        }
+    }
+    unpin_frame(frame_id, false);
+    return false;
+}
+
+bool BufferManager::clean_frame(Partition &partition, frame_id_t frame_id) {
+    auto &frame = get_frame(frame_id);
+    std::unique_lock latch(partition.latch_);
+    // the frame may have been pinned, evicted or cleaned since it was chosen
+    if (frame.page_id() == INVALID_PAGE_ID || !frame.dirty() || !frame.try_lock_for_eviction()) {
+        return false;
+    }
+    frame.start_io();
+    latch.unlock();
+    bool written = true;
+    try {
+        storage_->write_page_aligned(frame.page_id(), frame.page());
+    } catch (...) {
+        // leave the page dirty, so that the eviction writes it back and reports the error
+        written = false;
+    }
+    latch.lock();
+    if (written) {
         frame.set_dirty(false);
     }
+    frame.finish_io();
+    frame.unlock_for_eviction();
+    return written;
 }
 
-bool BufferManager::page_allocated(page_id_t page_id) {
-    std::scoped_lock latch(latch_);
-    return disk_manager_->page_allocated(page_id);
+void BufferManager::background_writer(BackgroundWriterOptions options) {
+    auto last_dump = std::chrono::steady_clock::now();
+    std::unique_lock latch(background_writer_latch_);
+    while (!stop_background_writer_) {
+        latch.unlock();
+        clean_victim_candidates(options.clean_fraction_, options.max_writes_per_round_);
+        retire_frames();
+        if (!options.resident_pages_file_.empty() &&
+            std::chrono::steady_clock::now() - last_dump >= options.dump_interval_) {
+            try {
+                dump_resident_pages(options.resident_pages_file_);
+            } catch (const IOException &) {
+                // the previous dump is still in place, and the next round tries again
+            }
+            last_dump = std::chrono::steady_clock::now();
+        }
+        latch.lock();
+        background_writer_cv_.wait_for(latch, options.interval_, [this]() { return stop_background_writer_; });
+    }
+}
+
+void BufferManager::add_frames(size_t count) {
+    auto first_frame_id = num_frames_;
+    auto end_frame_id = first_frame_id + count;
+    auto num_chunks = (end_frame_id + FRAME_CHUNK_SIZE - 1) >> FRAME_CHUNK_BITS;
+    if (num_chunks > frame_directory_capacity_) {
+        auto capacity = std::max(num_chunks, frame_directory_capacity_ * 2);
+        auto directory = std::make_unique<BufferFrame *[]>(capacity);
+        std::copy(frame_directory_.load(), frame_directory_.load() + frame_chunks_.size(), directory.get());
+        frame_directory_.store(directory.get(), std::memory_order_release);
+        frame_directories_.emplace_back(std::move(directory));
+        frame_directory_capacity_ = capacity;
+    }
+    // the new chunks are not visible to lookups until their frames are put in the free lists under the latches
+    while (frame_chunks_.size() < num_chunks) {
+        frame_chunks_.emplace_back(std::make_unique<BufferFrame[]>(FRAME_CHUNK_SIZE));
+        frame_directory_.load()[frame_chunks_.size() - 1] = frame_chunks_.back().get();
+    }
+    auto &arena = arenas_.emplace_back(std::make_unique<PageArena>(count));
+    for (size_t i = 0; i < count; ++i) {
+        auto &frame = get_frame(first_frame_id + i);
+        frame.set_page(arena->page(i));
+        frame.try_lock_for_eviction();
+    }
+    num_frames_ = end_frame_id;
+
+    for (size_t i = 0; i < num_partitions_; ++i) {
+        auto &partition = partitions_[i];
+        std::scoped_lock latch(partition.latch_);
+        // retired frames are taken from the back, so the new frames are pushed in descending order to be used in order
+        auto first = first_frame_id + (i + num_partitions_ - first_frame_id % num_partitions_) % num_partitions_;
+        std::vector<frame_id_t> frame_ids;
+        for (auto frame_id = first; frame_id < end_frame_id; frame_id += num_partitions_) {
+            frame_ids.emplace_back(frame_id);
+        }
+        partition.retired_frames_.insert(partition.retired_frames_.end(), frame_ids.rbegin(), frame_ids.rend());
+        revive_frames(partition);
+    }
+}
+
+void BufferManager::revive_frames(Partition &partition) {
+    size_t revived = 0;
+    while (partition.size_ < partition.target_size_ && !partition.retired_frames_.empty()) {
+        auto frame_id = partition.retired_frames_.back();
+        partition.retired_frames_.pop_back();
+        get_frame(frame_id).unlock_for_eviction();
+        partition.free_list_.emplace_back(frame_id);
+        ++partition.size_;
+        ++revived;
+    }
+    if (partition.size_ > partition.page_table().max_size()) {
+        auto page_table = std::make_unique<PageTable>(partition.size_);
+        partition.page_table().for_each(
+            [&](page_id_t page_id, frame_id_t frame_id) { page_table->insert(page_id, frame_id); });
+        partition.page_table_.store(page_table.get(), std::memory_order_release);
+        partition.page_tables_.emplace_back(std::move(page_table));
+    }
+    pool_size_.fetch_add(revived);
+}
+
+size_t BufferManager::retire_frames() {
+    size_t retired = 0;
+    for (size_t i = 0; i < num_partitions_; ++i) {
+        auto &partition = partitions_[i];
+        std::unique_lock latch(partition.latch_);
+        for (size_t batch = 0; partition.size_ > partition.target_size_; ++batch) {
+            if (batch == RETIRE_BATCH_SIZE) {
+                // let the fetches waiting for the latch go first
+                latch.unlock();
+                std::this_thread::yield();
+                latch.lock();
+                batch = 0;
+            }
+            auto frame_id = get_victim_frame(partition, latch);
+            if (frame_id == INVALID_FRAME_ID) {
+                // the remaining frames are pinned
+                break;
+            }
+            if (partition.size_ <= partition.target_size_) {
+                // the pool has grown again while the victim was being written back
+                release_victim_frame(partition, frame_id);
+                break;
+            }
+            // the frame stays locked for eviction, so that stale lookups cannot pin it
+            auto &frame = get_frame(frame_id);
+            reset_frame_metadata(partition, frame_id, INVALID_PAGE_ID);
+            PageArena::release_page(frame.page());
+            partition.retired_frames_.emplace_back(frame_id);
+            --partition.size_;
+            pool_size_.fetch_sub(1);
+            ++retired;
+        }
+    }
+    return retired;
+}
+
+size_t BufferManager::dump_resident_pages(const std::string &file_name) {
+    std::vector<ResidentPage> pages;
+    std::unordered_map<frame_id_t, uint64_t> recencies;
+    for (size_t i = 0; i < num_partitions_; ++i) {
+        auto &partition = partitions_[i];
+        std::scoped_lock latch(partition.latch_);
+        // the candidates come from the least recently used one, and the frames missing from the replacer are pinned
+        auto candidates = partition.replacer_->candidates(partition.replacer_->size());
+        recencies.clear();
+        for (size_t j = 0; j < candidates.size(); ++j) {
+            recencies[candidates[j]] = candidates.size() - j;
+        }
+        partition.page_table().for_each([&](page_id_t page_id, frame_id_t frame_id) {
+            auto iter = recencies.find(frame_id);
+            pages.push_back({page_id, iter == recencies.end() ? 0 : iter->second});
+        });
+    }
+
+    auto tmp_file_name = file_name + ".tmp";
+    int fd = open(tmp_file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+    if (fd < 0) {
+        throw IOException(fmt::format("cannot open file {}", tmp_file_name));
+    }
+    try {
+        uint64_t count = pages.size();
+        read_or_write_all(fd, reinterpret_cast<char *>(&count), sizeof(count), true);
+        read_or_write_all(fd, reinterpret_cast<char *>(pages.data()), pages.size() * sizeof(ResidentPage), true);
+        if (fsync(fd) < 0) {
+            throw IOException(fmt::format("cannot sync file {}", tmp_file_name));
+        }
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    if (std::rename(tmp_file_name.c_str(), file_name.c_str()) < 0) {
+        throw IOException(fmt::format("cannot rename file {} to {}", tmp_file_name, file_name));
+    }
+    return pages.size();
 }
 
-void BufferManager::unpin_page(page_id_t page_id, bool dirty) {
-    std::scoped_lock latch(latch_);
-    auto iter = page_table_.find(page_id);
-    auto frame_id = iter->second;
-    auto &frame = frames_[frame_id];
+bool BufferManager::start_reload(const std::string &file_name) {
+    assert(!reloader_.joinable());
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return false;
+        }
+        throw IOException(fmt::format("cannot open file {}", file_name));
+    }
+    std::vector<ResidentPage> pages;
+    try {
+        struct stat buf;
+        if (fstat(fd, &buf) < 0) {
+            throw IOException("cannot get file size");
+        }
+        uint64_t count;
+        read_or_write_all(fd, reinterpret_cast<char *>(&count), sizeof(count), false);
+        if (buf.st_size != static_cast<off_t>(sizeof(count) + count * sizeof(ResidentPage))) {
+            throw IOException(fmt::format("corrupted resident pages file {}", file_name));
+        }
+        pages.resize(count);
+        read_or_write_all(fd, reinterpret_cast<char *>(pages.data()), count * sizeof(ResidentPage), false);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+
+    // keep the most recently used pages that fit, and read them in the order of their ids
+    std::sort(pages.begin(), pages.end(), [](const ResidentPage &a, const ResidentPage &b) {
+        return a.recency_ < b.recency_;
+    });
+    pages.resize(std::min(pages.size(), size()));
+    std::sort(pages.begin(), pages.end(), [](const ResidentPage &a, const ResidentPage &b) {
+        return a.page_id_ < b.page_id_;
+    });
+    stop_reloader_.store(false);
+    reloaded_pages_.store(0);
+    reloader_ = std::thread([this, pages = std::move(pages)]() mutable { reloader(std::move(pages)); });
+    return true;
+}
+
+size_t BufferManager::wait_reload() {
+    if (reloader_.joinable()) {
+        reloader_.join();
+    }
+    return reloaded_pages_.load();
+}
+
+void BufferManager::reloader(std::vector<ResidentPage> pages) {
+    std::vector<io::Storage::IoRequest> reads;
+    std::vector<frame_id_t> frame_ids;
+    std::vector<size_t> page_indexes;
+    std::vector<size_t> unpin_order;
+    for (size_t begin = 0; begin < pages.size() && !stop_reloader_.load(); begin += PREFETCH_BATCH_SIZE) {
+        auto end = std::min(begin + PREFETCH_BATCH_SIZE, pages.size());
+        reads.clear();
+        frame_ids.clear();
+        page_indexes.clear();
+        for (size_t i = begin; i < end; ++i) {
+            auto page_id = pages[i].page_id_;
+            auto &partition = partition_of(page_id);
+            std::unique_lock latch(partition.latch_);
+            // the reload only takes free frames, so it never evicts the pages fetched in the meantime. The free list is
+            // checked again once start_read() takes the latch back.
+            if (partition.free_list_.empty() || partition.page_table().find(page_id) != INVALID_FRAME_ID) {
+                continue;
+            }
+            frame_id_t frame_id;
+            try {
+                frame_id = start_read(partition, latch, page_id, nullptr, true);
+            } catch (...) {
+                continue;
+            }
+            if (frame_id != INVALID_FRAME_ID) {
+                reads.push_back({page_id, get_frame(frame_id).page(), false, false});
+                frame_ids.emplace_back(frame_id);
+                page_indexes.emplace_back(i);
+            }
+        }
+        if (reads.empty()) {
+            continue;
+        }
+        storage_->wait(storage_->submit(reads.data(), reads.size()));
+        for (size_t i = 0; i < reads.size(); ++i) {
+            finish_read(reads[i].page_id_, frame_ids[i], reads[i].succeeded_);
+        }
+        // unpin the pages from the least recently used one, so that the replacers keep their order within a batch
+        unpin_order.resize(reads.size());
+        for (size_t i = 0; i < unpin_order.size(); ++i) {
+            unpin_order[i] = i;
+        }
+        std::sort(unpin_order.begin(), unpin_order.end(), [&](size_t a, size_t b) {
+            return pages[page_indexes[a]].recency_ > pages[page_indexes[b]].recency_;
+        });
+        for (auto i : unpin_order) {
+            if (reads[i].succeeded_) {
+                unpin_frame(frame_ids[i], false);
+                reloaded_pages_.fetch_add(1);
+            }
+        }
+    }
+}
+
+frame_id_t BufferManager::start_read(Partition &partition,
+                                     std::unique_lock<std::mutex> &latch,
+                                     page_id_t page_id,
+                                     BufferAccessStrategy *strategy,
+                                     bool free_frame_only) {
+    // the allocation bitmap is protected by the storage, so there is no need to hold the latch
+    latch.unlock();
+    bool allocated = storage_->page_allocated(page_id);
+    latch.lock();
+    if (!allocated || partition.page_table().find(page_id) != INVALID_FRAME_ID) {
+        return INVALID_FRAME_ID;
+    }
+    auto ring = strategy ? &strategy->ring(partition_index_of(page_id), num_partitions_) : nullptr;
+    // a free frame is clean, so the latch is not released to take it
+    auto frame_id = free_frame_only ? lock_free_frame(partition) : get_victim_frame(partition, latch, ring);
+    if (frame_id == INVALID_FRAME_ID) {
+        return INVALID_FRAME_ID;
+    }
+    if (partition.page_table().find(page_id) != INVALID_FRAME_ID) {
+        // another thread has loaded the page while the victim was being written back
+        release_victim_frame(partition, frame_id);
+        return INVALID_FRAME_ID;
+    }
+    auto &frame = get_frame(frame_id);
+    reset_frame_metadata(partition, frame_id, page_id);
+    frame.start_io();
+    frame.pin();
+    frame.unlock_for_eviction();
+    if (ring) {
+        ring->record(frame_id, page_id);
+    }
+    return frame_id;
+}
+
+void BufferManager::finish_read(page_id_t page_id, frame_id_t frame_id, bool succeeded) {
+    auto &frame = get_frame(frame_id);
+    if (succeeded) {
+        frame.finish_io();
+        return;
+    }
+    auto &partition = partition_of(page_id);
+    std::scoped_lock latch(partition.latch_);
+    // threads waiting on the frame may still pin it for a while, so victim selection will skip it until then
+    reset_frame_metadata(partition, frame_id, INVALID_PAGE_ID);
+    partition.free_list_.emplace_back(frame_id);
+    frame.finish_io();
     frame.unpin();
-    if (frame.pin_count() == 0) {
-        replacer_->unpin(frame_id);
+}
+
+void BufferManager::prefetcher() {
+    std::vector<PrefetchRequest> requests;
+    std::vector<io::Storage::IoRequest> reads;
+    std::vector<frame_id_t> frame_ids;
+    std::unique_lock latch(prefetch_latch_);
+    while (true) {
+        prefetch_cv_.wait(latch, [this]() { return stop_prefetchers_ || !prefetch_requests_.empty(); });
+        if (stop_prefetchers_) {
+            return;
+        }
+        requests.clear();
+        // the frames of a batch stay pinned until the whole batch is read, so the batches are limited to a quarter of
+        // the pool altogether, leaving frames for the fetches. The pool may have been resized since the last batch.
+        auto batch_size = std::clamp<size_t>(pool_size_.load() / 4 / PREFETCH_THREADS, 1, PREFETCH_BATCH_SIZE);
+        while (!prefetch_requests_.empty() && requests.size() < batch_size) {
+            requests.emplace_back(std::move(prefetch_requests_.front()));
+            prefetch_requests_.pop_front();
+        }
+        latch.unlock();
+
+        reads.clear();
+        frame_ids.clear();
+        for (auto &request : requests) {
+            auto &partition = partition_of(request.page_id_);
+            std::unique_lock partition_latch(partition.latch_);
+            if (partition.page_table().find(request.page_id_) != INVALID_FRAME_ID) {
+                continue;
+            }
+            frame_id_t frame_id;
+            try {
+                frame_id = start_read(
+                    partition, partition_latch, request.page_id_, request.strategy_ ? &*request.strategy_ : nullptr);
+            } catch (...) {
+                // a prefetch is only a hint. The error is reported when the page is fetched.
+                continue;
+            }
+            if (frame_id != INVALID_FRAME_ID) {
+                reads.push_back({request.page_id_, get_frame(frame_id).page(), false, false});
+                frame_ids.emplace_back(frame_id);
+            }
+        }
+        if (!reads.empty()) {
+            storage_->wait(storage_->submit(reads.data(), reads.size()));
+            for (size_t i = 0; i < reads.size(); ++i) {
+                finish_read(reads[i].page_id_, frame_ids[i], reads[i].succeeded_);
+                if (reads[i].succeeded_) {
+                    // the page is unpinned as soon as it is loaded
+                    unpin_frame(frame_ids[i], false);
+                    stats_.add(StatsCollector::Prefetches);
+                }
+            }
+        }
+        latch.lock();
     }
-    if (dirty) {
-        frame.set_dirty(true);
+}
+
+frame_id_t BufferManager::get_victim_frame(Partition &partition,
+                                           std::unique_lock<std::mutex> &latch,
+                                           const BufferAccessStrategy::Ring *ring) {
+    auto start = std::chrono::steady_clock::now();
+    auto selected = [&](frame_id_t frame_id) {
+        stats_.record(StatsCollector::VictimLatency, std::chrono::steady_clock::now() - start);
+        return frame_id;
+    };
+    while (true) {
+        auto victim = lock_victim_frame(partition, ring);
+        if (victim == INVALID_FRAME_ID) {
+            return selected(INVALID_FRAME_ID);
+        }
+        auto &frame = get_frame(victim);
+        if (frame.page_id() != INVALID_PAGE_ID) {
+            stats_.add(StatsCollector::Evictions);
+        }
+        if (!frame.dirty()) {
+            return selected(victim);
+        }
+        stats_.add(StatsCollector::DirtyEvictions);
+        // write back the dirty page without holding the latch. The page stays in the page table until it is clean, so
+        // that threads fetching it wait on the frame instead of reading a stale copy from disk.
+        frame.start_io();
+        latch.unlock();
+        try {
+            storage_->write_page_aligned(frame.page_id(), frame.page());
+        } catch (...) {
+            latch.lock();
+            frame.finish_io();
+            frame.unlock_for_eviction();
+            if (frame.pin_count() == 0) {
+                partition.replacer_->restore(victim);
+                frame.set_in_replacer(true);
+            }
+            throw;
+        }
+        latch.lock();
+        frame.set_dirty(false);
+        frame.finish_io();
+        if (frame.pin_count() == 0) {
+            return selected(victim);
+        }
+        // the page has been fetched again during the write-back, so it is no longer a victim
+        frame.unlock_for_eviction();
     }
 }
 
-frame_id_t BufferManager::get_victim_frame() {
-    if (!free_list_.empty()) {
-        auto victim = free_list_.front();
-        free_list_.pop_front();
+frame_id_t BufferManager::lock_victim_frame(Partition &partition, const BufferAccessStrategy::Ring *ring) {
+    // recycle the oldest frame of the ring if it still holds the page the scan loaded into it
+    if (auto slot = ring ? ring->candidate() : nullptr; slot) {
+        auto &frame = get_frame(slot->frame_id_);
+        if (frame.page_id() == slot->page_id_ && frame.try_lock_for_eviction()) {
+            if (frame.page_id() == slot->page_id_) {
+                partition.replacer_->pin(slot->frame_id_);
+                frame.set_in_replacer(false);
+                return slot->frame_id_;
+            }
+            frame.unlock_for_eviction();
+        }
+    }
+    if (auto victim = lock_free_frame(partition); victim != INVALID_FRAME_ID) {
         return victim;
     }
-    return replacer_->victim();
+    frame_id_t victim;
+    std::vector<frame_id_t> cleaning_frames;
+    // every frame hit since it was last considered gets a second chance, but only once per call
+    auto second_chances = partition.replacer_->size();
+    while ((victim = partition.replacer_->victim()) != INVALID_FRAME_ID) {
+        auto &frame = get_frame(victim);
+        frame.set_in_replacer(false);
+        if (frame.try_lock_for_eviction()) {
+            if (second_chances == 0 || !frame.clear_referenced()) {
+                break;
+            }
+            // count the hits made without the latch as an access
+            --second_chances;
+            partition.replacer_->unpin(victim);
+            frame.set_in_replacer(true);
+            frame.unlock_for_eviction();
+            continue;
+        }
+        // an unpinned frame can only be locked by the background writer, which does not put it back to the replacer.
+        // Otherwise the frame has been pinned through the lock-free path, and goes back when it is unpinned.
+        if (frame.pin_count() == 0) {
+            cleaning_frames.emplace_back(victim);
+        }
+    }
+    for (auto frame_id : cleaning_frames) {
+        partition.replacer_->restore(frame_id);
+        get_frame(frame_id).set_in_replacer(true);
+    }
+    return victim;
+}
+
+frame_id_t BufferManager::lock_free_frame(Partition &partition) {
+    // a free frame can only be pinned transiently by a stale lookup on the lock-free path
+    for (auto n = partition.free_list_.size(); n > 0; --n) {
+        auto frame_id = partition.free_list_.front();
+        partition.free_list_.pop_front();
+        if (get_frame(frame_id).try_lock_for_eviction()) {
+            return frame_id;
+        }
+        partition.free_list_.emplace_back(frame_id);
+    }
+    return INVALID_FRAME_ID;
+}
+
+void BufferManager::release_victim_frame(Partition &partition, frame_id_t frame_id) {
+    auto &frame = get_frame(frame_id);
+    frame.unlock_for_eviction();
+    if (frame.page_id() == INVALID_PAGE_ID) {
+        partition.free_list_.emplace_front(frame_id);
+    } else {
+        partition.replacer_->restore(frame_id);
+        frame.set_in_replacer(true);
+    }
 }
 
-void BufferManager::reset_frame_metadata(frame_id_t frame_id, page_id_t new_page_id) {
-    auto &frame = frames_[frame_id];
+void BufferManager::reset_frame_metadata(Partition &partition, frame_id_t frame_id, page_id_t new_page_id) {
+    auto &frame = get_frame(frame_id);
 
-    page_table_.erase(frame.page_id());
+    partition.page_table().erase(frame.page_id());
+    // the access history of the old page does not carry over to the new one
+    partition.replacer_->remove(frame_id);
+    frame.set_in_replacer(false);
+    frame.clear_referenced();
     if (new_page_id != INVALID_PAGE_ID) {
-        page_table_.emplace(new_page_id, frame_id);
+        partition.page_table().insert(new_page_id, frame_id);
     }
 
     frame.set_page_id(new_page_id);
     frame.set_dirty(false);
 }
-}  // namespace naivedb::buffer
\ No newline at end of file
+
+std::unique_ptr<Replacer> BufferManager::make_replacer(ReplacementPolicy policy,
+                                                       size_t num_frames,
+                                                       size_t partition_index,
+                                                       size_t num_partitions) {
+    switch (policy) {
+        case ReplacementPolicy::Lru:
+            return std::make_unique<LruReplacer>(num_frames, partition_index, num_partitions);
+        case ReplacementPolicy::Clock:
+            return std::make_unique<ClockReplacer>(num_frames, partition_index, num_partitions);
+        case ReplacementPolicy::LruK:
+            return std::make_unique<LruKReplacer>();
+    }
+    UNREACHABLE;
+}
+
+storage::PageGuard BufferManager::make_page_guard(frame_id_t frame_id) {
+    auto &frame = get_frame(frame_id);
+    return storage::PageGuard(frame.page(), frame.page_id(), &frame.rwlatch(), this, frame_id);
+}
+}  // namespace naivedb::buffer
@@ -1,21 +1,33 @@
 #pragma once
 
+#include "buffer/buffer_access_strategy.h"
 #include "buffer/buffer_frame.h"
+#include "buffer/buffer_stats.h"
+#include "buffer/page_arena.h"
+#include "buffer/page_table.h"
 #include "buffer/replacer.h"
 #include "common/macros.h"
 #include "common/types.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <stddef.h>
-#include <unordered_map>
+#include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 namespace naivedb {
 namespace io {
-class DiskManager;
+class Storage;
 }
 namespace storage {
 class PageGuard;
@@ -23,6 +35,45 @@ class PageGuard;
 }  // namespace naivedb
 
 namespace naivedb::buffer {
+/**
+ * @brief The options of the background writer of BufferManager.
+ *
+ */
+struct BackgroundWriterOptions {
+    // the fraction of the evictable frames of each partition, counted from the next victim, to keep clean
+    double clean_fraction_ = 0.25;
+    // the maximum number of pages written in each round over all the partitions
+    size_t max_writes_per_round_ = 64;
+    // the delay between two rounds
+    std::chrono::milliseconds interval_ = std::chrono::milliseconds(50);
+    // if not empty, the resident pages are dumped to this file every dump_interval_, for a warm restart
+    std::string resident_pages_file_;
+    std::chrono::milliseconds dump_interval_ = std::chrono::seconds(60);
+};
+
+/**
+ * @brief The state of a checkpoint, which BufferManager::checkpoint() updates as it goes.
+ *
+ */
+struct CheckpointProgress {
+    // the number of pages that are dirty when the checkpoint starts
+    size_t dirty_pages_ = 0;
+    size_t pages_written_ = 0;
+    // the number of those pages that have been evicted, cleaned by someone else or freed before being reached
+    size_t pages_skipped_ = 0;
+};
+
+/**
+ * @brief Options of BufferManager::checkpoint().
+ *
+ */
+struct CheckpointOptions {
+    // the maximum number of pages written per second, or 0 for no limit
+    size_t max_pages_per_second_ = 0;
+    // called after each batch of writes, if set
+    std::function<void(const CheckpointProgress &)> on_progress_;
+};
+
 /**
  * @brief BufferManager reads disk pages to and from its internal buffer pool.
  *
@@ -31,23 +82,80 @@ class BufferManager {
     DISALLOW_COPY_AND_MOVE(BufferManager)
 
   public:
-    BufferManager(size_t pool_size, io::DiskManager *disk_manager);
+    /**
+     * @brief Construct a new BufferManager object.
+     *
+     * @param pool_size the total number of frames in the buffer pool
+     * @param storage the store of the pages, such as a DiskManager
+     * @param num_partitions the number of independent partitions the pool is split into. Pages are hashed to partitions
+     * by their page ids, and each partition has its own page table, free list, replacer and latch.
+     * @param policy the replacement policy of the replacers
+     */
+    BufferManager(size_t pool_size,
+                  io::Storage *storage,
+                  size_t num_partitions = 1,
+                  ReplacementPolicy policy = ReplacementPolicy::Lru);
+
+    ~BufferManager();
+
+    /**
+     * @brief Get the number of frames in the buffer pool.
+     *
+     * @return size_t
+     */
+    size_t size() const { return pool_size_.load(); }
 
     /**
-     * @brief Get the size of the buffer pool.
+     * @brief Get the number of partitions of the buffer pool.
      *
      * @return size_t
      */
-    size_t size() const { return pool_size_; }
+    size_t partitions() const { return num_partitions_; }
+
+    /**
+     * @brief Change the number of frames in the buffer pool while it is in use. Growing adds the new frames to the free
+     * lists at once. Shrinking evicts unpinned pages, writing back the dirty ones, and gives the memory of their frames
+     * back to the system. It takes a few frames at a time and releases the partition latch in between, so that
+     * fetches keep going. The frames that cannot be evicted because they are pinned are retired later by the
+     * background writer or by the next call.
+     *
+     * @param new_size the number of frames, at least one per partition
+     * @return size_t the number of frames after the call, which is above new_size if the pool is still shrinking
+     */
+    size_t resize(size_t new_size);
 
     /**
      * @brief Fetch a page from the buffer pool and pin it. Return the page if it has been loaded in memory. Otherwise,
      * load the page from disk to memory and return it.
      *
      * @param page_id
+     * @param strategy if not null, a miss recycles a frame from the ring of the strategy instead of evicting a page
+     * chosen by the replacer
      * @return std::optional<storage::PageGuard>
      */
-    std::optional<storage::PageGuard> fetch_page(page_id_t page_id);
+    std::optional<storage::PageGuard> fetch_page(page_id_t page_id, BufferAccessStrategy *strategy = nullptr);
+
+    /**
+     * @brief Fetch a page and pin it only if it is in the buffer pool and not being read. This never blocks on I/O. It
+     * is counted as a probe rather than a hit in the statistics.
+     *
+     * @param page_id
+     * @return std::optional<storage::PageGuard>
+     */
+    std::optional<storage::PageGuard> try_fetch_page(page_id_t page_id);
+
+    /**
+     * @brief Load the pages into the buffer pool asynchronously, and leave them unpinned. This is only a hint: pages
+     * that are resident, unallocated or cannot get a frame are skipped, and so are requests beyond the capacity of the
+     * prefetch queue. A later fetch_page() of a page being loaded waits for the read instead of reading it again.
+     *
+     * The prefetchers submit the reads in batches, so with the io_uring backend of DiskManager many reads are in
+     * flight at once.
+     *
+     * @param page_ids
+     * @param strategy if not null, the pages are loaded with this strategy
+     */
+    void prefetch(const std::vector<page_id_t> &page_ids, const BufferAccessStrategy *strategy = nullptr);
 
     /**
      * @brief Allocate a new page on the disk and fetch it.
@@ -75,11 +183,36 @@ class BufferManager {
     bool flush_page(page_id_t page_id);
 
     /**
-     * @brief Flush all the pages in the buffer pool to disk.
+     * @brief Flush all the dirty pages in the buffer pool to disk. This is a checkpoint without throttling.
      *
      */
     void flush_all_pages();
 
+    /**
+     * @brief Take a fuzzy checkpoint: write back the pages that are dirty when it starts while the buffer pool stays in
+     * use. The dirty pages are collected under the latch of one partition at a time, sorted by page id, and written in
+     * batches, so that runs of adjacent pages are written with a single system call. The pages cleaned by an eviction
+     * or the background writer in the meantime are skipped, and so are the pages that become dirty after the start,
+     * which belong to the next checkpoint. A fetch only waits if it needs an unpinned page while it is being written.
+     *
+     * A page becomes dirty whenever a guard modifies it, and a pinned page is copied under its shared latch, so that it
+     * is not written torn. A caller needing a recovery point, such as a log position, takes it just before calling
+     * this: every modification made before then is on disk when this returns.
+     *
+     * @param options
+     * @param progress
+     * @return uint64_t the epoch of the checkpoint, which last_checkpoint() returns once it is complete
+     */
+    uint64_t checkpoint(const CheckpointOptions &options, CheckpointProgress &progress);
+
+    /**
+     * @brief Get the epoch of the last complete checkpoint, or 0 if there is none. The epochs of the checkpoints count
+     * up from 1.
+     *
+     * @return uint64_t
+     */
+    uint64_t last_checkpoint() const { return last_checkpoint_.load(); }
+
     /**
      * @brief Check whether the given page is allocated.
      *
@@ -89,26 +222,333 @@ class BufferManager {
      */
     bool page_allocated(page_id_t page_id);
 
+    /**
+     * @brief Get the lowest page id that is not allocated in the storage, without allocating it.
+     *
+     * @return page_id_t the page id, or INVALID_PAGE_ID if no page can be allocated
+     */
+    page_id_t lowest_free_page_id();
+
+    /**
+     * @brief Truncate the database file after the last allocated page.
+     *
+     * @return size_t the number of bytes the file has shrunk by
+     */
+    size_t truncate_free_tail();
+
+    /**
+     * @brief Start a thread that periodically writes back the dirty pages about to be evicted, so that evictions seldom
+     * have to write a page before reusing its frame. The thread is stopped when the buffer manager is destroyed.
+     *
+     * @param options
+     */
+    void start_background_writer(const BackgroundWriterOptions &options = {});
+
+    /**
+     * @brief Stop the background writer and wait for it to exit. Do nothing if it is not running.
+     *
+     */
+    void stop_background_writer();
+
+    /**
+     * @brief Run one round of the background writer in the calling thread: write back the dirty unpinned pages among
+     * the next victims of each partition. The background writer also retires the frames left by resize().
+     *
+     * @param clean_fraction the fraction of the evictable frames of each partition, counted from the next victim, to
+     * write back
+     * @param max_writes the maximum number of pages to write
+     * @return size_t the number of pages written
+     */
+    size_t clean_victim_candidates(double clean_fraction, size_t max_writes);
+
+    /**
+     * @brief Write the ids of the resident pages and how recently they have been used to a file, so that the buffer
+     * pool can be warmed up by start_reload() after a restart. The file is replaced atomically.
+     *
+     * @param file_name
+     * @return size_t the number of pages written
+     */
+    size_t dump_resident_pages(const std::string &file_name);
+
+    /**
+     * @brief Start reloading the pages dumped by dump_resident_pages() in a background thread, while the buffer pool is
+     * already serving fetches. If the pages do not all fit, the most recently used ones are chosen. They are read in
+     * the order of their ids, in batches, and only into free frames, so the pages fetched in the meantime are never
+     * evicted by the reload. The pages that are resident or no longer allocated are skipped.
+     *
+     * @param file_name
+     * @return true
+     * @return false if the file does not exist
+     */
+    bool start_reload(const std::string &file_name);
+
+    /**
+     * @brief Wait for the reload started by start_reload() to finish.
+     *
+     * @return size_t the number of pages reloaded
+     */
+    size_t wait_reload();
+
+    /**
+     * @brief Take a snapshot of the counters and latency histograms of the buffer pool. The counters are updated
+     * without synchronization between them, so a snapshot taken during activity may be slightly inconsistent.
+     *
+     * @return BufferPoolStats
+     */
+    BufferPoolStats stats() const { return stats_.snapshot(); }
+
   private:
+    friend class storage::PageGuard;
+
+    /**
+     * @brief Partition is an independent slice of the buffer pool. It owns a disjoint subset of the frames and only
+     * caches pages hashed to it, so operations on different partitions never contend on the same latch.
+     *
+     * The page table can be read without the latch. The replacer is updated lazily: a frame pinned through the
+     * lock-free path stays in the replacer, so victims are validated with BufferFrame::try_lock_for_eviction(). When
+     * such a frame is unpinned, it is only marked as referenced, and the access is counted once the replacer offers it
+     * as a victim, as in CLOCK. Hits therefore take no latch, neither to pin nor to unpin.
+     *
+     * The frames of a partition are those whose ids are congruent to its index modulo the number of partitions.
+     */
+    struct alignas(64) Partition {
+        PageTable &page_table() const { return *page_table_.load(std::memory_order_acquire); }
+
+        // the page table is replaced by a larger one when the partition grows. The old tables are kept, since lock-free
+        // lookups may still be reading them.
+        std::atomic<PageTable *> page_table_{nullptr};
+        std::vector<std::unique_ptr<PageTable>> page_tables_;
+        std::list<frame_id_t> free_list_;
+        std::unique_ptr<Replacer> replacer_;
+        // the frames given up by shrinking the pool. They stay locked for eviction until growing the pool reuses them.
+        std::vector<frame_id_t> retired_frames_;
+        // the number of frames that are not retired, and the number the partition is being resized to
+        size_t size_ = 0;
+        size_t target_size_ = 0;
+        std::mutex latch_;
+    };
+
+    size_t partition_index_of(page_id_t page_id) const { return page_id % num_partitions_; }
+    Partition &partition_of(page_id_t page_id) { return partitions_[partition_index_of(page_id)]; }
+
+    BufferFrame &get_frame(frame_id_t frame_id) const {
+        auto directory = frame_directory_.load(std::memory_order_acquire);
+        return directory[frame_id >> FRAME_CHUNK_BITS][frame_id & (FRAME_CHUNK_SIZE - 1)];
+    }
+
+    /**
+     * @brief Create frames with new ids and retire them in their partitions, then let the partitions below their
+     * target sizes take them. The resize latch must be held.
+     *
+     * @param count
+     */
+    void add_frames(size_t count);
+
+    /**
+     * @brief Bring back retired frames to the free list until the partition reaches its target size, and replace the
+     * page table if it gets too small. The latch of the partition must be held.
+     *
+     * @param partition
+     */
+    void revive_frames(Partition &partition);
+
+    /**
+     * @brief Evict and retire frames of the partitions above their target sizes, a batch at a time.
+     *
+     * @return size_t the number of frames retired
+     */
+    size_t retire_frames();
+
     /**
-     * @brief Unpin the page from the buffer pool.
+     * @brief Unpin the frame. If the frame becomes unpinned, it is put back to the replacer as the most recently used,
+     * or only marked as referenced without any latch if it has stayed in the replacer.
      * @warning This method should be called by PageGuard. Do not use this manually!
      *
-     * @param page_id
+     * @param frame_id
      * @param dirty
      */
-    void unpin_page(page_id_t page_id, bool dirty);
+    void unpin_frame(frame_id_t frame_id, bool dirty);
+
+    /**
+     * @brief Mark a pinned frame as dirty before its guard is released.
+     * @warning This method should be called by PageGuard. Do not use this manually!
+     *
+     * @param frame_id
+     */
+    void mark_frame_dirty(frame_id_t frame_id) { get_frame(frame_id).mark_dirty(checkpoint_epoch_.load()); }
+
+    /**
+     * @brief Try to pin a resident page without taking any latch.
+     *
+     * @param frame_id the frame found in the page table
+     * @param page_id
+     * @return true if the frame is pinned and holds the page
+     */
+    bool pin_resident_frame(frame_id_t frame_id, page_id_t page_id);
+
+    /**
+     * @brief Pick a victim frame in the partition and lock it for eviction. If the victim is dirty, it is written back
+     * with the partition latch released, so the caller must recheck the page table after this call.
+     *
+     * @param partition
+     * @param latch the held latch of the partition
+     * @param ring the ring of the caller's access strategy in this partition, or nullptr
+     * @return frame_id_t a clean frame locked for eviction, or INVALID_FRAME_ID if all the frames are pinned
+     */
+    frame_id_t get_victim_frame(Partition &partition,
+                                std::unique_lock<std::mutex> &latch,
+                                const BufferAccessStrategy::Ring *ring = nullptr);
+
+    /**
+     * @brief Take a frame from the ring, the free list or the replacer and lock it for eviction.
+     *
+     * @param partition
+     * @param ring
+     * @return frame_id_t
+     */
+    frame_id_t lock_victim_frame(Partition &partition, const BufferAccessStrategy::Ring *ring);
+
+    /**
+     * @brief Take a frame from the free list and lock it for eviction.
+     *
+     * @param partition
+     * @return frame_id_t the frame, or INVALID_FRAME_ID if the free list has no frame that can be locked
+     */
+    frame_id_t lock_free_frame(Partition &partition);
+
+    /**
+     * @brief Give back a victim frame obtained from get_victim_frame() without using it.
+     *
+     * @param partition
+     * @param frame_id
+     */
+    void release_victim_frame(Partition &partition, frame_id_t frame_id);
+
+    /**
+     * @brief Write back a dirty unpinned frame for the background writer. The frame is locked for eviction during the
+     * write, so that it stays in the replacer and fetches of its page wait for the write.
+     *
+     * @param partition
+     * @param frame_id
+     * @return true if the page is written
+     */
+    bool clean_frame(Partition &partition, frame_id_t frame_id);
+
+    void background_writer(BackgroundWriterOptions options);
+
+    /**
+     * @brief Take a frame for a page that is not in the page table, and mark it as being read. The frame is pinned and
+     * put in the page table, so that other fetches of the page wait for the read.
+     *
+     * @param partition the partition of the page
+     * @param latch the held latch of the partition, which is held again when this returns
+     * @param page_id
+     * @param strategy
+     * @param free_frame_only whether to only take a free frame, so that no page is evicted
+     * @return frame_id_t the frame to read the page into, or INVALID_FRAME_ID if the page is not allocated, no frame is
+     * available or the page has been loaded by another thread in the meantime
+     */
+    frame_id_t start_read(Partition &partition,
+                          std::unique_lock<std::mutex> &latch,
+                          page_id_t page_id,
+                          BufferAccessStrategy *strategy,
+                          bool free_frame_only = false);
+
+    /**
+     * @brief Complete a read started by start_read(). If the read failed, the frame is unpinned and freed.
+     *
+     * @param page_id
+     * @param frame_id
+     * @param succeeded
+     */
+    void finish_read(page_id_t page_id, frame_id_t frame_id, bool succeeded);
+
+    struct PrefetchRequest {
+        page_id_t page_id_;
+        std::optional<BufferAccessStrategy> strategy_;
+    };
+
+    void prefetcher();
+
+    /**
+     * @brief An entry of the file written by dump_resident_pages().
+     *
+     */
+    struct ResidentPage {
+        page_id_t page_id_;
+        // the rank of the page in its partition: 0 if it is pinned, otherwise from 1 for the most recently used page
+        uint64_t recency_;
+    };
+
+    void reloader(std::vector<ResidentPage> pages);
+
+    void reset_frame_metadata(Partition &partition, frame_id_t frame_id, page_id_t new_page_id);
+    storage::PageGuard make_page_guard(frame_id_t frame_id);
+
+    /**
+     * @brief Create the replacer of a partition.
+     *
+     * @param policy
+     * @param num_frames the number of frames in the partition
+     * @param partition_index
+     * @param num_partitions
+     * @return std::unique_ptr<Replacer>
+     */
+    static std::unique_ptr<Replacer> make_replacer(ReplacementPolicy policy,
+                                                   size_t num_frames,
+                                                   size_t partition_index,
+                                                   size_t num_partitions);
+
+    // the frames are allocated in chunks which never move, and found through a directory of the chunks. A full
+    // directory is replaced by a larger copy, and the old ones are kept for the lookups that may still be reading them.
+    static constexpr size_t FRAME_CHUNK_BITS = 6;
+    static constexpr size_t FRAME_CHUNK_SIZE = size_t(1) << FRAME_CHUNK_BITS;
+    // the maximum number of frames retired by a partition before its latch is released for a while
+    static constexpr size_t RETIRE_BATCH_SIZE = 16;
+
+    std::atomic<size_t> pool_size_;
+    const size_t num_partitions_;
+
+    std::atomic<BufferFrame **> frame_directory_;
+    std::vector<std::unique_ptr<BufferFrame *[]>> frame_directories_;
+    size_t frame_directory_capacity_;
+    std::vector<std::unique_ptr<BufferFrame[]>> frame_chunks_;
+    std::vector<std::unique_ptr<PageArena>> arenas_;
+    // the number of frame ids in use, including the retired frames
+    size_t num_frames_;
+    std::mutex resize_latch_;
+
+    std::unique_ptr<Partition[]> partitions_;
+    io::Storage *storage_;
+
+    StatsCollector stats_;
+
+    // the checkpoints are serialized. A page that becomes dirty gets the epoch of the next checkpoint to start.
+    std::mutex checkpoint_latch_;
+    std::atomic<uint64_t> checkpoint_epoch_;
+    std::atomic<uint64_t> last_checkpoint_;
+
+    std::thread background_writer_;
+    std::mutex background_writer_latch_;
+    std::condition_variable background_writer_cv_;
+    bool stop_background_writer_;
 
-    frame_id_t get_victim_frame();
-    void reset_frame_metadata(frame_id_t frame_id, page_id_t new_page_id);
+    // the maximum number of pages pinned and written together by flush_all_pages()
+    static constexpr size_t FLUSH_BATCH_SIZE = 64;
+    static constexpr size_t PREFETCH_THREADS = 4;
+    static constexpr size_t MAX_PREFETCH_REQUESTS = 256;
+    // the maximum number of reads submitted together by a prefetcher
+    static constexpr size_t PREFETCH_BATCH_SIZE = 32;
 
-    const size_t pool_size_;
+    // the prefetchers are started by the first prefetch() call
+    std::vector<std::thread> prefetchers_;
+    std::deque<PrefetchRequest> prefetch_requests_;
+    std::mutex prefetch_latch_;
+    std::condition_variable prefetch_cv_;
+    bool stop_prefetchers_;
 
-    std::unique_ptr<BufferFrame[]> frames_;
-    std::unique_ptr<Replacer> replacer_;
-    io::DiskManager *disk_manager_;
-    std::unordered_map<page_id_t, frame_id_t> page_table_;
-    std::list<frame_id_t> free_list_;
-    std::mutex latch_;
+    std::thread reloader_;
+    std::atomic<bool> stop_reloader_;
+    std::atomic<size_t> reloaded_pages_;
 };
-}  // namespace naivedb::buffer
\ No newline at end of file
+}  // namespace naivedb::buffer
@@ -0,0 +1,31 @@
+#include "buffer/buffer_stats.h"
+
+namespace naivedb::buffer {
+BufferPoolStats StatsCollector::snapshot() const {
+    uint64_t counters[NUM_COUNTERS] = {};
+    LatencyHistogram histograms[NUM_HISTOGRAMS];
+    for (size_t i = 0; i < SHARDS; ++i) {
+        auto &shard = shards_[i];
+        for (size_t j = 0; j < NUM_COUNTERS; ++j) {
+            counters[j] += shard.counters_[j].load(std::memory_order_relaxed);
+        }
+        for (size_t j = 0; j < NUM_HISTOGRAMS; ++j) {
+            for (size_t k = 0; k < LatencyHistogram::BUCKETS; ++k) {
+                histograms[j].add(k, shard.histograms_[j][k].load(std::memory_order_relaxed));
+            }
+        }
+    }
+    BufferPoolStats stats;
+    stats.hits_ = counters[Hits];
+    stats.misses_ = counters[Misses];
+    stats.probes_ = counters[Probes];
+    stats.pin_waits_ = counters[PinWaits];
+    stats.prefetches_ = counters[Prefetches];
+    stats.evictions_ = counters[Evictions];
+    stats.dirty_evictions_ = counters[DirtyEvictions];
+    stats.background_writes_ = counters[BackgroundWrites];
+    stats.miss_latency_ = histograms[MissLatency];
+    stats.victim_latency_ = histograms[VictimLatency];
+    return stats;
+}
+}  // namespace naivedb::buffer
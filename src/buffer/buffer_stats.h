@@ -0,0 +1,170 @@
+#pragma once
+
+#include "common/format.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stddef.h>
+
+namespace naivedb::buffer {
+/**
+ * @brief A histogram of latencies with a bucket for each power of two of nanoseconds. Bucket 0 counts latencies below
+ * 2 ns, and bucket i > 0 counts latencies in [2^i, 2^(i+1)) ns.
+ *
+ */
+class LatencyHistogram {
+  public:
+    static constexpr size_t BUCKETS = 40;
+
+    static size_t bucket_of(std::chrono::nanoseconds latency) {
+        auto ns = static_cast<uint64_t>(std::max<int64_t>(latency.count(), 1));
+        return std::min<size_t>(63 - __builtin_clzll(ns), BUCKETS - 1);
+    }
+
+    uint64_t bucket(size_t index) const { return buckets_[index]; }
+
+    void add(size_t index, uint64_t count) { buckets_[index] += count; }
+
+    uint64_t count() const {
+        uint64_t total = 0;
+        for (auto count : buckets_) {
+            total += count;
+        }
+        return total;
+    }
+
+    /**
+     * @brief Get an upper bound of a percentile of the latencies.
+     *
+     * @param fraction the percentile, between 0 and 1
+     * @return std::chrono::nanoseconds the upper bound of the bucket the percentile falls in, or 0 if the histogram is
+     * empty
+     */
+    std::chrono::nanoseconds percentile(double fraction) const {
+        auto total = count();
+        if (total == 0) {
+            return std::chrono::nanoseconds(0);
+        }
+        auto rank = static_cast<uint64_t>(fraction * total);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += buckets_[i];
+            if (seen > rank || i == BUCKETS - 1) {
+                return std::chrono::nanoseconds(int64_t(2) << i);
+            }
+        }
+        return std::chrono::nanoseconds(0);
+    }
+
+  private:
+    std::array<uint64_t, BUCKETS> buckets_{};
+};
+
+/**
+ * @brief A snapshot of the counters of BufferManager since it was created.
+ *
+ */
+struct BufferPoolStats {
+    // the number of fetches of pages that are in the buffer pool
+    uint64_t hits_ = 0;
+    // the number of fetches that read the page from the storage
+    uint64_t misses_ = 0;
+    // the number of try_fetch_page() calls that find the page, which are lookups such as read-ahead rather than
+    // accesses, so they are not counted as hits
+    uint64_t probes_ = 0;
+    // the number of fetches that wait for the page to be read or written back by another thread
+    uint64_t pin_waits_ = 0;
+    // the number of pages read by the prefetchers
+    uint64_t prefetches_ = 0;
+    // the number of times a page is evicted to make room for another page
+    uint64_t evictions_ = 0;
+    // the number of those evictions that have to write the page back first
+    uint64_t dirty_evictions_ = 0;
+    // the number of pages written back by the background writer
+    uint64_t background_writes_ = 0;
+    // the latencies of the fetches that miss, including the victim selection and the read
+    LatencyHistogram miss_latency_;
+    // the latencies of victim selections, including the write-back of dirty victims
+    LatencyHistogram victim_latency_;
+
+    double hit_ratio() const { return hits_ + misses_ == 0 ? 0 : static_cast<double>(hits_) / (hits_ + misses_); }
+};
+
+/**
+ * @brief StatsCollector gathers the counters of a buffer manager in shards, each on its own cache line, and each thread
+ * updates the shard it is assigned to. Threads rarely share a shard, so counting a hit does not bounce a cache line
+ * between cores. The counters are only summed up when a snapshot is taken.
+ *
+ */
+class StatsCollector {
+  public:
+    enum Counter {
+        Hits,
+        Misses,
+        Probes,
+        PinWaits,
+        Prefetches,
+        Evictions,
+        DirtyEvictions,
+        BackgroundWrites,
+        NUM_COUNTERS
+    };
+    enum Histogram { MissLatency, VictimLatency, NUM_HISTOGRAMS };
+
+    StatsCollector() : shards_(std::make_unique<Shard[]>(SHARDS)) {}
+
+    void add(Counter counter, uint64_t n = 1) { shard().counters_[counter].fetch_add(n, std::memory_order_relaxed); }
+
+    void record(Histogram histogram, std::chrono::nanoseconds latency) {
+        shard().histograms_[histogram][LatencyHistogram::bucket_of(latency)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    BufferPoolStats snapshot() const;
+
+  private:
+    static constexpr size_t SHARDS = 32;
+
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> counters_[NUM_COUNTERS] = {};
+        std::atomic<uint64_t> histograms_[NUM_HISTOGRAMS][LatencyHistogram::BUCKETS] = {};
+    };
+
+    Shard &shard() {
+        static std::atomic<size_t> next_shard = 0;
+        thread_local size_t index = next_shard.fetch_add(1) % SHARDS;
+        return shards_[index];
+    }
+
+    std::unique_ptr<Shard[]> shards_;
+};
+}  // namespace naivedb::buffer
+
+namespace fmt {
+template <>
+struct formatter<naivedb::buffer::BufferPoolStats> : public naivedb_base_formatter {
+    template <typename FormatContext>
+    auto format(const naivedb::buffer::BufferPoolStats &obj, FormatContext &ctx) -> decltype(ctx.out()) {
+        return format_to(ctx.out(),
+                         "BufferPoolStats {{ hits_: {}, misses_: {}, hit_ratio: {:.3f}, probes_: {}, pin_waits_: {}, "
+                         "prefetches_: {}, evictions_: {}, dirty_evictions_: {}, background_writes_: {}, "
+                         "miss_latency_: {{ p50: {}ns, p99: {}ns }}, victim_latency_: {{ p50: {}ns, p99: {}ns }} }}",
+                         obj.hits_,
+                         obj.misses_,
+                         obj.hit_ratio(),
+                         obj.probes_,
+                         obj.pin_waits_,
+                         obj.prefetches_,
+                         obj.evictions_,
+                         obj.dirty_evictions_,
+                         obj.background_writes_,
+                         obj.miss_latency_.percentile(0.5).count(),
+                         obj.miss_latency_.percentile(0.99).count(),
+                         obj.victim_latency_.percentile(0.5).count(),
+                         obj.victim_latency_.percentile(0.99).count());
+    }
+};
+}  // namespace fmt
@@ -0,0 +1,87 @@
+#include "buffer/clock_replacer.h"
+
+#include "common/constants.h"
+#include "common/types.h"
+
+#include <cassert>
+#include <vector>
+
+namespace naivedb::buffer {
+ClockReplacer::ClockReplacer(size_t num_frames, frame_id_t first_frame_id, size_t frame_id_stride)
+    : first_frame_id_(first_frame_id), frame_id_stride_(frame_id_stride), flags_(num_frames, 0), hand_(0), size_(0) {}
+
+frame_id_t ClockReplacer::victim() {
+    if (size_ == 0) {
+        return INVALID_FRAME_ID;
+    }
+    // every referenced frame is cleared in the first round, so a victim is found within two rounds
+    while (true) {
+        auto &flags = flags_[hand_];
+        auto index = hand_;
+        hand_ = (hand_ + 1) % flags_.size();
+        if (flags & REFERENCED) {
+            flags &= ~REFERENCED;
+        } else if (flags & EVICTABLE) {
+            flags = 0;
+            --size_;
+            return frame_id_of(index);
+        }
+    }
+}
+
+void ClockReplacer::pin(frame_id_t frame_id) {
+    auto index = index_of(frame_id);
+    if (index >= flags_.size()) {
+        return;
+    }
+    auto &flags = flags_[index];
+    if (flags & EVICTABLE) {
+        --size_;
+    }
+    flags = 0;
+}
+
+void ClockReplacer::unpin(frame_id_t frame_id) {
+    assert(frame_id >= first_frame_id_ && (frame_id - first_frame_id_) % frame_id_stride_ == 0);
+    auto index = index_of(frame_id);
+    if (index >= flags_.size()) {
+        flags_.resize(index + 1, 0);
+    }
+    auto &flags = flags_[index];
+    if (!(flags & EVICTABLE)) {
+        ++size_;
+    }
+    flags = EVICTABLE | REFERENCED;
+}
+
+void ClockReplacer::restore(frame_id_t frame_id) {
+    assert(frame_id >= first_frame_id_ && (frame_id - first_frame_id_) % frame_id_stride_ == 0);
+    auto index = index_of(frame_id);
+    if (index >= flags_.size()) {
+        flags_.resize(index + 1, 0);
+    }
+    auto &flags = flags_[index];
+    if (flags & EVICTABLE) {
+        return;
+    }
+    ++size_;
+    // without the reference bit, the frame is evicted the next time the hand reaches it
+    flags = EVICTABLE;
+}
+
+size_t ClockReplacer::size() const { return size_; }
+
+std::vector<frame_id_t> ClockReplacer::candidates(size_t max_count) const {
+    // the unreferenced frames are reached in the first round, and the referenced ones in the second round
+    std::vector<frame_id_t> frame_ids;
+    for (uint8_t flags : {EVICTABLE, static_cast<uint8_t>(EVICTABLE | REFERENCED)}) {
+        for (size_t i = 0; i < flags_.size() && frame_ids.size() < max_count; ++i) {
+            auto index = (hand_ + i) % flags_.size();
+            if (flags_[index] == flags) {
+                frame_ids.emplace_back(frame_id_of(index));
+            }
+        }
+    }
+    return frame_ids;
+}
+}  // namespace naivedb::buffer
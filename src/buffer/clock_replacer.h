@@ -0,0 +1,51 @@
+#pragma once
+
+#include "buffer/replacer.h"
+#include "common/types.h"
+
+#include <cstdint>
+#include <stddef.h>
+#include <vector>
+
+namespace naivedb::buffer {
+/**
+ * @brief An implementation of the replacer with CLOCK replacement policy.
+ *
+ * Each frame has an evictable bit and a reference bit. Unpinning a frame sets both bits, restoring it only sets the
+ * evictable bit, and pinning it clears the evictable bit. The clock hand sweeps the frames, clears the reference bits it passes, and evicts the first evictable
+ * frame whose reference bit is already cleared. Neither pin() nor unpin() allocates memory once the frames are covered.
+ */
+class ClockReplacer : public Replacer {
+  public:
+    /**
+     * @brief Construct a new ClockReplacer object.
+     *
+     * @param num_frames the number of frames expected to be tracked by the replacer. The replacer grows if it is given
+     * a frame id beyond this range.
+     * @param first_frame_id the smallest frame id tracked by the replacer
+     * @param frame_id_stride the distance between two consecutive frame ids tracked by the replacer
+     */
+    explicit ClockReplacer(size_t num_frames, frame_id_t first_frame_id = 0, size_t frame_id_stride = 1);
+    ~ClockReplacer() = default;
+
+    frame_id_t victim() override;
+    void pin(frame_id_t frame_id) override;
+    void unpin(frame_id_t frame_id) override;
+    void restore(frame_id_t frame_id) override;
+    size_t size() const override;
+    std::vector<frame_id_t> candidates(size_t max_count) const override;
+
+  private:
+    static constexpr uint8_t EVICTABLE = 1;
+    static constexpr uint8_t REFERENCED = 2;
+
+    size_t index_of(frame_id_t frame_id) const { return (frame_id - first_frame_id_) / frame_id_stride_; }
+    frame_id_t frame_id_of(size_t index) const { return first_frame_id_ + index * frame_id_stride_; }
+
+    const frame_id_t first_frame_id_;
+    const size_t frame_id_stride_;
+    std::vector<uint8_t> flags_;
+    size_t hand_;
+    size_t size_;
+};
+}  // namespace naivedb::buffer
@@ -0,0 +1,96 @@
+#include "buffer/lru_k_replacer.h"
+
+#include "common/constants.h"
+#include "common/types.h"
+
+#include <cassert>
+#include <vector>
+
+namespace naivedb::buffer {
+LruKReplacer::LruKReplacer(size_t k, uint64_t correlated_reference_period)
+    : k_(k), correlated_reference_period_(correlated_reference_period), current_timestamp_(0) {
+    assert(k > 0);
+}
+
+frame_id_t LruKReplacer::victim() {
+    if (evictable_frames_.empty()) {
+        return INVALID_FRAME_ID;
+    }
+    // skip the frames still within their correlated reference period if possible
+    auto victim_iter = evictable_frames_.begin();
+    for (auto iter = evictable_frames_.begin(); iter != evictable_frames_.end(); ++iter) {
+        if (current_timestamp_ - histories_[iter->second].timestamps_.back() >= correlated_reference_period_) {
+            victim_iter = iter;
+            break;
+        }
+    }
+    auto victim = victim_iter->second;
+    evictable_frames_.erase(victim_iter);
+    histories_[victim].evictable_ = false;
+    return victim;
+}
+
+void LruKReplacer::pin(frame_id_t frame_id) {
+    auto iter = histories_.find(frame_id);
+    if (iter == histories_.end() || !iter->second.evictable_) {
+        return;
+    }
+    evictable_frames_.erase({eviction_key(iter->second), frame_id});
+    iter->second.evictable_ = false;
+}
+
+void LruKReplacer::unpin(frame_id_t frame_id) {
+    auto &history = histories_[frame_id];
+    if (history.evictable_) {
+        evictable_frames_.erase({eviction_key(history), frame_id});
+    }
+    auto now = ++current_timestamp_;
+    if (!history.timestamps_.empty() && now - history.timestamps_.back() < correlated_reference_period_) {
+        history.timestamps_.back() = now;
+    } else {
+        history.timestamps_.emplace_back(now);
+        if (history.timestamps_.size() > k_) {
+            history.timestamps_.pop_front();
+        }
+    }
+    history.evictable_ = true;
+    evictable_frames_.emplace(eviction_key(history), frame_id);
+}
+
+void LruKReplacer::restore(frame_id_t frame_id) {
+    auto iter = histories_.find(frame_id);
+    if (iter == histories_.end()) {
+        unpin(frame_id);
+        return;
+    }
+    if (!iter->second.evictable_) {
+        iter->second.evictable_ = true;
+        evictable_frames_.emplace(eviction_key(iter->second), frame_id);
+    }
+}
+
+void LruKReplacer::remove(frame_id_t frame_id) {
+    // the frame holds another page, so its history is meaningless now
+    pin(frame_id);
+    histories_.erase(frame_id);
+}
+
+size_t LruKReplacer::size() const { return evictable_frames_.size(); }
+
+std::vector<frame_id_t> LruKReplacer::candidates(size_t max_count) const {
+    // ignore the correlated reference periods, which only matter at the time of eviction
+    std::vector<frame_id_t> frame_ids;
+    for (auto iter = evictable_frames_.begin(); iter != evictable_frames_.end() && frame_ids.size() < max_count;
+         ++iter) {
+        frame_ids.emplace_back(iter->second);
+    }
+    return frame_ids;
+}
+
+LruKReplacer::EvictionKey LruKReplacer::eviction_key(const FrameHistory &history) const {
+    if (history.timestamps_.size() < k_) {
+        return {false, history.timestamps_.back()};
+    }
+    return {true, history.timestamps_.front()};
+}
+}  // namespace naivedb::buffer
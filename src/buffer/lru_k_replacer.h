@@ -0,0 +1,75 @@
+#pragma once
+
+#include "buffer/replacer.h"
+#include "common/types.h"
+
+#include <cstdint>
+#include <deque>
+#include <set>
+#include <stddef.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace naivedb::buffer {
+/**
+ * @brief An implementation of the replacer with LRU-K replacement policy.
+ *
+ * Each unpin() counts as an access to the frame. The replacer keeps the timestamps of the last K accesses of each
+ * frame and evicts the frame with the largest backward K-distance, i.e. the one whose K-th most recent access is the
+ * oldest. Frames with fewer than K accesses have an infinite distance and are evicted first, in LRU order, so pages
+ * touched once by a scan are evicted before the frequently used ones.
+ *
+ * An access within the correlated reference period after the previous access of the same frame is considered
+ * correlated with it (e.g. several tuples read from the same page by one query). It only refreshes the last timestamp
+ * instead of counting as a new access. A frame accessed within the period is not evicted unless there is no other
+ * choice. Timestamps and the period are measured in the number of accesses to the replacer.
+ *
+ * The history of a frame is kept when victim() returns it, since the buffer manager may fail to evict it and put it
+ * back with restore(). It is only forgotten by remove(), once the frame holds another page.
+ */
+class LruKReplacer : public Replacer {
+  public:
+    static constexpr size_t DEFAULT_K = 2;
+    static constexpr uint64_t DEFAULT_CORRELATED_REFERENCE_PERIOD = 16;
+
+    /**
+     * @brief Construct a new LruKReplacer object.
+     *
+     * @param k the number of access timestamps kept for each frame
+     * @param correlated_reference_period the number of accesses after an access during which further accesses to the
+     * same frame are considered correlated with it. 0 disables correlation.
+     */
+    explicit LruKReplacer(size_t k = DEFAULT_K,
+                          uint64_t correlated_reference_period = DEFAULT_CORRELATED_REFERENCE_PERIOD);
+    ~LruKReplacer() = default;
+
+    frame_id_t victim() override;
+    void pin(frame_id_t frame_id) override;
+    void unpin(frame_id_t frame_id) override;
+    void restore(frame_id_t frame_id) override;
+    void remove(frame_id_t frame_id) override;
+    size_t size() const override;
+    std::vector<frame_id_t> candidates(size_t max_count) const override;
+
+  private:
+    struct FrameHistory {
+        // timestamps of the last K uncorrelated accesses, the most recent one at the back
+        std::deque<uint64_t> timestamps_;
+        bool evictable_ = false;
+    };
+
+    // frames with fewer than K accesses are ordered by (0, last access), others by (1, K-th most recent access), so
+    // that the first key in the set is the one with the largest backward K-distance
+    using EvictionKey = std::pair<bool, uint64_t>;
+
+    EvictionKey eviction_key(const FrameHistory &history) const;
+
+    const size_t k_;
+    const uint64_t correlated_reference_period_;
+    uint64_t current_timestamp_;
+
+    std::unordered_map<frame_id_t, FrameHistory> histories_;
+    std::set<std::pair<EvictionKey, frame_id_t>> evictable_frames_;
+};
+}  // namespace naivedb::buffer
@@ -3,32 +3,98 @@
 #include "common/constants.h"
 #include "common/types.h"
 
-#include <utility>
+#include <cassert>
+#include <vector>
 
 namespace naivedb::buffer {
+LruReplacer::LruReplacer(size_t num_frames, frame_id_t first_frame_id, size_t frame_id_stride)
+    : first_frame_id_(first_frame_id)
+    , frame_id_stride_(frame_id_stride)
+    , nodes_(num_frames, Node{NIL, NIL, false})
+    , head_(NIL)
+    , tail_(NIL)
+    , size_(0) {}
+
 frame_id_t LruReplacer::victim() {
-    if (frames_.empty()) {
+    if (tail_ == NIL) {
         return INVALID_FRAME_ID;
     }
-    auto victim = frames_.back();
-    frames_.pop_back();
-    map_.erase(victim);
-    return victim;
+    auto index = tail_;
+    unlink(index);
+    return frame_id_of(index);
 }
 
 void LruReplacer::pin(frame_id_t frame_id) {
-    if (auto iter = map_.find(frame_id); iter != map_.end()) {
-        frames_.erase(iter->second);
-        map_.erase(iter);
+    auto index = index_of(frame_id);
+    if (index < nodes_.size() && nodes_[index].linked_) {
+        unlink(index);
     }
 }
 
 void LruReplacer::unpin(frame_id_t frame_id) {
-    if (auto iter = map_.find(frame_id); iter == map_.end()) {
-        frames_.push_front(frame_id);
-        map_.insert({frame_id, frames_.begin()});
+    assert(frame_id >= first_frame_id_ && (frame_id - first_frame_id_) % frame_id_stride_ == 0);
+    auto index = index_of(frame_id);
+    if (index >= nodes_.size()) {
+        nodes_.resize(index + 1, Node{NIL, NIL, false});
+    }
+    auto &node = nodes_[index];
+    if (node.linked_) {
+        return;
+    }
+    node = {NIL, head_, true};
+    if (head_ != NIL) {
+        nodes_[head_].prev_ = index;
+    } else {
+        tail_ = index;
+    }
+    head_ = index;
+    ++size_;
+}
+
+void LruReplacer::restore(frame_id_t frame_id) {
+    assert(frame_id >= first_frame_id_ && (frame_id - first_frame_id_) % frame_id_stride_ == 0);
+    auto index = index_of(frame_id);
+    if (index >= nodes_.size()) {
+        nodes_.resize(index + 1, Node{NIL, NIL, false});
+    }
+    auto &node = nodes_[index];
+    if (node.linked_) {
+        return;
+    }
+    // the frame goes back to the least recently used end, where victim() found it
+    node = {tail_, NIL, true};
+    if (tail_ != NIL) {
+        nodes_[tail_].next_ = index;
+    } else {
+        head_ = index;
     }
+    tail_ = index;
+    ++size_;
 }
 
-size_t LruReplacer::size() const { return frames_.size(); }
-}  // namespace naivedb::buffer
\ No newline at end of file
+size_t LruReplacer::size() const { return size_; }
+
+std::vector<frame_id_t> LruReplacer::candidates(size_t max_count) const {
+    std::vector<frame_id_t> frame_ids;
+    for (auto index = tail_; index != NIL && frame_ids.size() < max_count; index = nodes_[index].prev_) {
+        frame_ids.emplace_back(frame_id_of(index));
+    }
+    return frame_ids;
+}
+
+void LruReplacer::unlink(size_t index) {
+    auto &node = nodes_[index];
+    if (node.prev_ != NIL) {
+        nodes_[node.prev_].next_ = node.next_;
+    } else {
+        head_ = node.next_;
+    }
+    if (node.next_ != NIL) {
+        nodes_[node.next_].prev_ = node.prev_;
+    } else {
+        tail_ = node.prev_;
+    }
+    node = {NIL, NIL, false};
+    --size_;
+}
+}  // namespace naivedb::buffer
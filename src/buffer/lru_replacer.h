@@ -3,27 +3,57 @@
 #include "buffer/replacer.h"
 #include "common/types.h"
 
-#include <list>
 #include <stddef.h>
-#include <unordered_map>
+#include <vector>
 
 namespace naivedb::buffer {
 /**
  * @brief An implementation of the replacer with LRU replacement policy.
  *
+ * The evictable frames form an intrusive doubly-linked list over an array indexed by frame id, so neither pin() nor
+ * unpin() allocates memory once the array covers the frame.
  */
 class LruReplacer : public Replacer {
   public:
-    LruReplacer() = default;
+    /**
+     * @brief Construct a new LruReplacer object.
+     *
+     * @param num_frames the number of frames expected to be tracked by the replacer. The replacer grows if it is given
+     * a frame id beyond this range.
+     * @param first_frame_id the smallest frame id tracked by the replacer
+     * @param frame_id_stride the distance between two consecutive frame ids tracked by the replacer
+     */
+    explicit LruReplacer(size_t num_frames = 0, frame_id_t first_frame_id = 0, size_t frame_id_stride = 1);
     ~LruReplacer() = default;
 
     frame_id_t victim() override;
     void pin(frame_id_t frame_id) override;
     void unpin(frame_id_t frame_id) override;
+    void restore(frame_id_t frame_id) override;
     size_t size() const override;
+    std::vector<frame_id_t> candidates(size_t max_count) const override;
 
   private:
-    std::list<frame_id_t> frames_;
-    std::unordered_map<frame_id_t, std::list<frame_id_t>::iterator> map_;
+    struct Node {
+        // indexes of the neighbours in nodes_, the more recently used one in prev_
+        size_t prev_;
+        size_t next_;
+        bool linked_;
+    };
+
+    static constexpr size_t NIL = static_cast<size_t>(-1);
+
+    size_t index_of(frame_id_t frame_id) const { return (frame_id - first_frame_id_) / frame_id_stride_; }
+    frame_id_t frame_id_of(size_t index) const { return first_frame_id_ + index * frame_id_stride_; }
+
+    void unlink(size_t index);
+
+    const frame_id_t first_frame_id_;
+    const size_t frame_id_stride_;
+    std::vector<Node> nodes_;
+    // the most and the least recently used frames
+    size_t head_;
+    size_t tail_;
+    size_t size_;
 };
-}  // namespace naivedb::buffer
\ No newline at end of file
+}  // namespace naivedb::buffer
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+
+namespace naivedb::buffer {
+/**
+ * @brief OptimisticLatch is a reader-writer latch with a version, which also lets readers skip the latch. It can be
+ * locked in the usual way through std::unique_lock and std::shared_lock.
+ *
+ * The version is odd while the latch is held exclusively, and each exclusive lock and unlock bumps it. An optimistic
+ * reader records the version, reads without latching, and validates the version afterwards: if it has changed, a
+ * writer may have run concurrently and what was read must be thrown away. A shared lock writes to the latch, so it
+ * bounces its cache line between the cores reading a hot page, while an optimistic read only loads the version.
+ *
+ * What an optimistic reader reads may be torn, so it must not trust it before validating, e.g. it must check offsets
+ * against the bounds of the page before following them.
+ */
+class OptimisticLatch {
+  public:
+    OptimisticLatch() : version_(0) {}
+
+    void lock() {
+        latch_.lock();
+        version_.fetch_add(1);
+    }
+
+    bool try_lock() {
+        if (!latch_.try_lock()) {
+            return false;
+        }
+        version_.fetch_add(1);
+        return true;
+    }
+
+    void unlock() {
+        version_.fetch_add(1);
+        latch_.unlock();
+    }
+
+    void lock_shared() { latch_.lock_shared(); }
+
+    bool try_lock_shared() { return latch_.try_lock_shared(); }
+
+    void unlock_shared() { latch_.unlock_shared(); }
+
+    /**
+     * @brief Start an optimistic read.
+     *
+     * @param version set to the version to validate the read with
+     * @return false if the latch is held exclusively, in which case the caller should take a shared lock instead
+     */
+    bool try_read_optimistic(uint64_t &version) const {
+        version = version_.load(std::memory_order_acquire);
+        return (version & 1) == 0;
+    }
+
+    /**
+     * @brief Check that no writer has held the latch since an optimistic read started.
+     *
+     * @param version the version returned by try_read_optimistic()
+     * @return true if what was read since is consistent
+     */
+    bool validate(uint64_t version) const {
+        // the reads before must not be reordered after the load of the version
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return version_.load(std::memory_order_relaxed) == version;
+    }
+
+  private:
+    std::shared_mutex latch_;
+    std::atomic<uint64_t> version_;
+};
+}  // namespace naivedb::buffer
@@ -0,0 +1,40 @@
+#include "buffer/page_arena.h"
+
+#include "common/constants.h"
+
+#include <new>
+#include <sys/mman.h>
+
+namespace naivedb::buffer {
+PageArena::PageArena(size_t num_pages) : data_(nullptr), size_(num_pages * PAGE_SIZE), huge_pages_(false) {
+    if (size_ == 0) {
+        return;
+    }
+    void *data = MAP_FAILED;
+    if (size_ % HUGE_PAGE_SIZE == 0) {
+        data = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        huge_pages_ = data != MAP_FAILED;
+    }
+    if (data == MAP_FAILED) {
+        // mmap() returns memory aligned to the system page size, which is a multiple of PAGE_SIZE
+        data = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        // only a hint, which fails harmlessly if transparent huge pages are disabled
+        madvise(data, size_, MADV_HUGEPAGE);
+    }
+    data_ = static_cast<char *>(data);
+}
+
+PageArena::~PageArena() {
+    if (data_) {
+        munmap(data_, size_);
+    }
+}
+
+void PageArena::release_page(char *page) {
+    // fails with EINVAL on explicit huge pages, which is harmless
+    madvise(page, PAGE_SIZE, MADV_DONTNEED);
+}
+}  // namespace naivedb::buffer
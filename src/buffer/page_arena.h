@@ -0,0 +1,55 @@
+#pragma once
+
+#include "common/constants.h"
+#include "common/macros.h"
+
+#include <stddef.h>
+
+namespace naivedb::buffer {
+/**
+ * @brief PageArena is a contiguous, page-aligned block of memory holding the pages of all the buffer frames, so that
+ * pages can be read from and written to a file opened with O_DIRECT without bouncing through another buffer.
+ *
+ * The arena is backed by explicit huge pages if the system has enough of them reserved. Otherwise it falls back to
+ * regular pages and asks for transparent huge pages.
+ */
+class PageArena {
+    DISALLOW_COPY_AND_MOVE(PageArena)
+
+  public:
+    /**
+     * @brief Allocate a zero-filled arena.
+     *
+     * @param num_pages
+     * @throw std::bad_alloc if the memory cannot be mapped
+     */
+    explicit PageArena(size_t num_pages);
+
+    ~PageArena();
+
+    char *page(size_t index) { return data_ + index * PAGE_SIZE; }
+
+    /**
+     * @brief Check whether the arena is backed by explicit huge pages.
+     *
+     * @return true
+     * @return false
+     */
+    bool huge_pages() const { return huge_pages_; }
+
+    /**
+     * @brief Give the memory of a page back to the system. The page reads as zeros afterwards and is backed again when
+     * it is written. This does nothing for explicit huge pages, which cannot be released in parts.
+     *
+     * @param page a page of an arena
+     */
+    static void release_page(char *page);
+
+  private:
+    static constexpr size_t HUGE_PAGE_SIZE = 2 << 20;
+
+    char *data_;
+    size_t size_;
+    bool huge_pages_;
+};
+}  // namespace naivedb::buffer
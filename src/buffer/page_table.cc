@@ -0,0 +1,60 @@
+#include "buffer/page_table.h"
+
+#include "common/constants.h"
+#include "common/types.h"
+
+#include <cassert>
+
+namespace naivedb::buffer {
+PageTable::PageTable(size_t max_size) {
+    // keep the load factor at most 1/2 so that probe sequences stay short
+    size_t bits = 1;
+    while ((size_t(1) << bits) < max_size * 2) {
+        ++bits;
+    }
+    mask_ = (size_t(1) << bits) - 1;
+    shift_ = 64 - bits;
+    slots_ = std::make_unique<Slot[]>(mask_ + 1);
+}
+
+void PageTable::insert(page_id_t page_id, frame_id_t frame_id) {
+    auto i = home(page_id);
+    while (slots_[i].page_id_.load(std::memory_order_relaxed) != INVALID_PAGE_ID) {
+        assert(slots_[i].page_id_.load(std::memory_order_relaxed) != page_id);
+        i = (i + 1) & mask_;
+    }
+    // publish the frame id before the page id, so that a lookup matching the page id sees a frame id at least as new
+    slots_[i].frame_id_.store(frame_id, std::memory_order_release);
+    slots_[i].page_id_.store(page_id, std::memory_order_release);
+}
+
+void PageTable::erase(page_id_t page_id) {
+    auto i = home(page_id);
+    while (true) {
+        auto slot_page_id = slots_[i].page_id_.load(std::memory_order_relaxed);
+        if (slot_page_id == INVALID_PAGE_ID) {
+            return;
+        }
+        if (slot_page_id == page_id) {
+            break;
+        }
+        i = (i + 1) & mask_;
+    }
+    // shift back the following entries whose home slots are not in (i, j], so no tombstone is needed
+    for (auto j = (i + 1) & mask_;; j = (j + 1) & mask_) {
+        auto moved_page_id = slots_[j].page_id_.load(std::memory_order_relaxed);
+        if (moved_page_id == INVALID_PAGE_ID) {
+            break;
+        }
+        auto k = home(moved_page_id);
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) {
+            continue;
+        }
+        slots_[i].frame_id_.store(slots_[j].frame_id_.load(std::memory_order_relaxed), std::memory_order_release);
+        slots_[i].page_id_.store(moved_page_id, std::memory_order_release);
+        i = j;
+    }
+    slots_[i].page_id_.store(INVALID_PAGE_ID, std::memory_order_release);
+    slots_[i].frame_id_.store(INVALID_FRAME_ID, std::memory_order_release);
+}
+}  // namespace naivedb::buffer
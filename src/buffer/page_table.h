@@ -0,0 +1,103 @@
+#pragma once
+
+#include "common/constants.h"
+#include "common/macros.h"
+#include "common/types.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace naivedb::buffer {
+/**
+ * @brief PageTable maps page ids to frame ids with linear probing.
+ *
+ * Lookups never take a latch. Insertions and deletions must be serialized by the caller, and deletions shift the
+ * following entries backwards instead of leaving tombstones. A concurrent lookup may therefore miss a page that is
+ * being moved, or return a frame that has just been reassigned, so callers must validate the returned frame and fall
+ * back to a serialized lookup if the validation fails.
+ */
+class PageTable {
+    DISALLOW_COPY_AND_MOVE(PageTable)
+
+    struct Slot {
+        std::atomic<page_id_t> page_id_{INVALID_PAGE_ID};
+        std::atomic<frame_id_t> frame_id_{INVALID_FRAME_ID};
+    };
+
+  public:
+    /**
+     * @brief Construct a new PageTable object.
+     *
+     * @param max_size the maximum number of pages stored in the table
+     */
+    explicit PageTable(size_t max_size);
+
+    /**
+     * @brief Look up the frame of the page. This is safe to call concurrently with insert() and erase().
+     *
+     * @param page_id
+     * @return frame_id_t INVALID_FRAME_ID if the page is not found
+     */
+    frame_id_t find(page_id_t page_id) const {
+        for (size_t i = home(page_id), n = 0; n <= mask_; i = (i + 1) & mask_, ++n) {
+            auto slot_page_id = slots_[i].page_id_.load(std::memory_order_acquire);
+            if (slot_page_id == page_id) {
+                return slots_[i].frame_id_.load(std::memory_order_acquire);
+            }
+            if (slot_page_id == INVALID_PAGE_ID) {
+                break;
+            }
+        }
+        return INVALID_FRAME_ID;
+    }
+
+    /**
+     * @brief Get the number of pages the table can hold while keeping its load factor at most 1/2.
+     *
+     * @return size_t
+     */
+    size_t max_size() const { return (mask_ + 1) / 2; }
+
+    /**
+     * @brief Insert a page that is not in the table yet.
+     *
+     * @param page_id
+     * @param frame_id
+     */
+    void insert(page_id_t page_id, frame_id_t frame_id);
+
+    /**
+     * @brief Remove a page from the table if it exists.
+     *
+     * @param page_id
+     */
+    void erase(page_id_t page_id);
+
+    /**
+     * @brief Call f(page_id, frame_id) on each page in the table. This must be serialized with insert() and erase().
+     *
+     * @tparam F
+     * @param f
+     */
+    template <typename F>
+    void for_each(F &&f) const {
+        for (size_t i = 0; i <= mask_; ++i) {
+            auto page_id = slots_[i].page_id_.load(std::memory_order_relaxed);
+            if (page_id != INVALID_PAGE_ID) {
+                f(page_id, slots_[i].frame_id_.load(std::memory_order_relaxed));
+            }
+        }
+    }
+
+  private:
+    size_t home(page_id_t page_id) const {
+        // Fibonacci hashing, which spreads page ids with a common stride (e.g. within a partition) over the table
+        return (static_cast<uint64_t>(page_id) * 11400714819323198485ull) >> shift_;
+    }
+
+    size_t mask_;
+    size_t shift_;
+    std::unique_ptr<Slot[]> slots_;
+};
+}  // namespace naivedb::buffer
@@ -3,8 +3,19 @@
 #include "common/types.h"
 
 #include <cstddef>
+#include <vector>
 
 namespace naivedb::buffer {
+/**
+ * @brief The replacement policies that can be used by the buffer manager.
+ *
+ */
+enum class ReplacementPolicy {
+    Lru,
+    Clock,
+    LruK,
+};
+
 /**
  * @brief Replacer is an abstract class that tracks page usage.
  *
@@ -31,7 +42,26 @@ class Replacer {
      */
     virtual void unpin(frame_id_t frame_id) = 0;
 
+    /**
+     * Put back a frame returned by victim() that could not be evicted, without counting it as an access.
+     * @param frame_id the id of the frame to put back
+     */
+    virtual void restore(frame_id_t frame_id) { unpin(frame_id); }
+
+    /**
+     * Forget a frame whose page is evicted or deleted, so that the next page held by the frame starts afresh.
+     * @param frame_id the id of the frame to forget
+     */
+    virtual void remove(frame_id_t frame_id) { pin(frame_id); }
+
     /** @return the number of elements in the replacer that can be victimized */
     virtual size_t size() const = 0;
+
+    /**
+     * Get the frames that would be victimized next, in eviction order, without removing them.
+     * @param max_count the maximum number of frames to return
+     * @return the frame ids
+     */
+    virtual std::vector<frame_id_t> candidates(size_t max_count) const = 0;
 };
 }  // namespace naivedb::buffer
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "catalog/schema.h"
 #include "catalog/table_info.h"
+#include "buffer/buffer_manager.h"
 #include "common/constants.h"
 #include "storage/table/table_heap.h"
 
@@ -45,9 +46,27 @@ table_id_t Catalog::create_table(std::string_view table_name, Schema &&schema) {
     return table_id;
 }
 
-void Catalog::drop_table(table_id_t table_id) {
+bool Catalog::drop_table(table_id_t table_id) {
     auto &table_info = table_info_[table_id];
+    storage::TableHeap table_heap(buffer_manager_, table_info.root_page_id_);
+    bool dropped = table_heap.drop();
+    // the pages freed so far are gone even if the drop fails
+    table_info.root_page_id_ = table_heap.root_page_id();
+    if (!dropped) {
+        return false;
+    }
     table_index_.erase(table_info.name_);
     free_slots_.emplace_back(table_id);
+    return true;
+}
+
+bool Catalog::compact(const storage::CompactionOptions &options, storage::CompactionProgress &progress) {
+    for (const auto &[name, table_id] : table_index_) {
+        if (!storage::TableHeap(buffer_manager_, table_info_[table_id].root_page_id_).compact(options, progress)) {
+            return false;
+        }
+    }
+    progress.bytes_released_ += buffer_manager_->truncate_free_tail();
+    return true;
 }
 }  // namespace naivedb::catalog
\ No newline at end of file
@@ -17,6 +17,10 @@ class BufferManager;
 namespace catalog {
 class TableInfo;
 }  // namespace catalog
+namespace storage {
+struct CompactionOptions;
+struct CompactionProgress;
+}  // namespace storage
 }  // namespace naivedb
 
 namespace naivedb::catalog {
@@ -41,7 +45,24 @@ class Catalog {
 
     table_id_t create_table(std::string_view table_name, Schema &&schema);
 
-    void drop_table(table_id_t table_id);
+    /**
+     * @brief Drop a table and free its pages.
+     *
+     * @param table_id
+     * @return false if a page of the table cannot be freed, e.g. because it is pinned. The table is kept with the pages
+     * left, which a later call frees.
+     */
+    bool drop_table(table_id_t table_id);
+
+    /**
+     * @brief Compact all the tables, then truncate the free space at the end of the database file. The tables must not
+     * be used during the compaction.
+     *
+     * @param options
+     * @param progress updated as pages are visited and moved
+     * @return false if the compaction of a table failed
+     */
+    bool compact(const storage::CompactionOptions &options, storage::CompactionProgress &progress);
 
   private:
     buffer::BufferManager *buffer_manager_;
@@ -0,0 +1,319 @@
+#include "io/compressed_storage.h"
+
+#include "common/exception.h"
+#include "common/format.h"
+#include "io/page_codec.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace naivedb::io {
+namespace {
+const char ZERO_PAGE[PAGE_SIZE] = {};
+
+void read_or_write_all(int fd, char *data, size_t size, size_t offset, bool write) {
+    while (size > 0) {
+        auto transferred = write ? pwrite(fd, data, size, offset) : pread(fd, data, size, offset);
+        if (transferred < 0 && errno == EINTR) {
+            continue;
+        }
+        if (transferred <= 0) {
+            throw IOException(
+                fmt::format("I/O error {} {} bytes at offset {}", write ? "writing" : "reading", size, offset));
+        }
+        data += transferred;
+        size -= transferred;
+        offset += transferred;
+    }
+}
+}  // namespace
+
+CompressedStorage::CompressedStorage(std::string_view file_name)
+    : file_name_(file_name), next_page_id_(0), end_unit_(0), stored_units_(0), next_ticket_(0) {
+    data_fd_ = open(file_name_.c_str(), O_RDWR | O_CREAT | O_DSYNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+    map_fd_ = open((file_name_ + ".map").c_str(), O_RDWR | O_CREAT | O_DSYNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+    if (data_fd_ < 0 || map_fd_ < 0) {
+        throw IOException(fmt::format("cannot open file {}", file_name));
+    }
+    struct stat buf;
+    if (fstat(map_fd_, &buf) < 0) {
+        throw IOException("cannot get file size");
+    }
+    size_t map_pages = (buf.st_size + PAGE_SIZE - 1) / PAGE_SIZE;
+    map_.resize(map_pages * ENTRIES_PER_MAP_PAGE);
+    read_or_write_all(map_fd_, reinterpret_cast<char *>(map_.data()), buf.st_size, 0, false);
+
+    // the free slots are the gaps between the slots in use
+    std::vector<std::pair<uint64_t, uint64_t>> slots;
+    for (size_t i = 0; i < map_.size(); ++i) {
+        if (!(map_[i] & ALLOCATED)) {
+            continue;
+        }
+        next_page_id_ = i + 1;
+        if (units(map_[i]) > 0) {
+            slots.emplace_back(first_unit(map_[i]), units(map_[i]));
+        }
+    }
+    for (page_id_t page_id = 0; page_id < next_page_id_; ++page_id) {
+        if (!(map_[page_id] & ALLOCATED)) {
+            free_page_ids_.insert(page_id);
+        }
+    }
+    std::sort(slots.begin(), slots.end());
+    for (auto [first, count] : slots) {
+        add_free_units(end_unit_, first - end_unit_);
+        end_unit_ = first + count;
+        stored_units_ += count;
+    }
+}
+
+CompressedStorage::~CompressedStorage() {
+    close(data_fd_);
+    close(map_fd_);
+}
+
+page_id_t CompressedStorage::alloc_page() {
+    std::scoped_lock latch(latch_);
+    page_id_t page_id;
+    if (!free_page_ids_.empty()) {
+        page_id = *free_page_ids_.begin();
+        free_page_ids_.erase(free_page_ids_.begin());
+    } else {
+        page_id = next_page_id_++;
+        if (static_cast<size_t>(page_id) >= map_.size()) {
+            map_.resize(map_.size() + ENTRIES_PER_MAP_PAGE);
+        }
+    }
+    // the page has no slot, so it reads as zeros
+    set_entry(page_id, ALLOCATED);
+    return page_id;
+}
+
+void CompressedStorage::free_page(page_id_t page_id) {
+    std::scoped_lock latch(latch_);
+    auto old_entry = entry(page_id);
+    set_entry(page_id, 0);
+    free_slot(old_entry);
+    free_page_ids_.insert(page_id);
+}
+
+page_id_t CompressedStorage::lowest_free_page_id() {
+    std::scoped_lock latch(latch_);
+    return free_page_ids_.empty() ? next_page_id_ : *free_page_ids_.begin();
+}
+
+size_t CompressedStorage::truncate_free_tail() {
+    std::scoped_lock latch(latch_);
+    // a slot being written is not in the map yet, but it is in use
+    uint64_t end = slot_ends_in_flight_.empty() ? 0 : *slot_ends_in_flight_.rbegin();
+    for (size_t i = 0; i < static_cast<size_t>(next_page_id_); ++i) {
+        if ((map_[i] & ALLOCATED) && units(map_[i]) > 0) {
+            end = std::max(end, first_unit(map_[i]) + units(map_[i]));
+        }
+    }
+    struct stat buf;
+    if (fstat(data_fd_, &buf) < 0) {
+        throw IOException("cannot get file size");
+    }
+    size_t size = buf.st_size;
+    if (end * UNIT_SIZE >= size) {
+        return 0;
+    }
+    if (ftruncate(data_fd_, end * UNIT_SIZE) < 0) {
+        throw IOException(fmt::format("cannot truncate file {} to {} bytes", file_name_, end * UNIT_SIZE));
+    }
+    // the free extents after the last slot in use lie wholly beyond it
+    while (!free_extents_.empty() && free_extents_.rbegin()->first >= end) {
+        erase_free_extent(std::prev(free_extents_.end()));
+    }
+    end_unit_ = end;
+    return size - end * UNIT_SIZE;
+}
+
+void CompressedStorage::read_page(page_id_t page_id, char *page_data) {
+    uint64_t page_entry;
+    {
+        std::scoped_lock latch(latch_);
+        page_entry = entry(page_id);
+    }
+    auto count = units(page_entry);
+    if (count == 0) {
+        std::memset(page_data, 0, PAGE_SIZE);
+        return;
+    }
+    if (count == UNITS_PER_PAGE) {
+        read_or_write_all(data_fd_, page_data, PAGE_SIZE, first_unit(page_entry) * UNIT_SIZE, false);
+        return;
+    }
+    char slot[PAGE_SIZE];
+    read_or_write_all(data_fd_, slot, count * UNIT_SIZE, first_unit(page_entry) * UNIT_SIZE, false);
+    uint16_t size;
+    std::memcpy(&size, slot, sizeof(size));
+    if (size > count * UNIT_SIZE - sizeof(size) || !decompress_block(slot + sizeof(size), size, page_data, PAGE_SIZE)) {
+        throw IOException(fmt::format("corrupted compressed page (page_id = {})", page_id));
+    }
+}
+
+void CompressedStorage::write_page(page_id_t page_id, const char *page_data) {
+    char slot[PAGE_SIZE];
+    size_t count;
+    if (std::memcmp(page_data, ZERO_PAGE, PAGE_SIZE) == 0) {
+        count = 0;
+    } else {
+        // a page is only compressed if that saves at least one unit
+        uint16_t size = static_cast<uint16_t>(compress_block(
+            page_data, PAGE_SIZE, slot + sizeof(size), (UNITS_PER_PAGE - 1) * UNIT_SIZE - sizeof(size)));
+        if (size > 0) {
+            std::memcpy(slot, &size, sizeof(size));
+            count = (sizeof(size) + size + UNIT_SIZE - 1) / UNIT_SIZE;
+        } else {
+            std::memcpy(slot, page_data, PAGE_SIZE);
+            count = UNITS_PER_PAGE;
+        }
+    }
+
+    uint64_t first = 0;
+    if (count > 0) {
+        {
+            std::scoped_lock latch(latch_);
+            entry(page_id);
+            first = alloc_slot(count);
+            slot_ends_in_flight_.insert(first + count);
+        }
+        try {
+            read_or_write_all(data_fd_, slot, count * UNIT_SIZE, first * UNIT_SIZE, true);
+        } catch (const IOException &) {
+            std::scoped_lock latch(latch_);
+            slot_ends_in_flight_.erase(slot_ends_in_flight_.find(first + count));
+            add_free_units(first, count);
+            throw;
+        }
+    }
+    std::scoped_lock latch(latch_);
+    if (count > 0) {
+        slot_ends_in_flight_.erase(slot_ends_in_flight_.find(first + count));
+    }
+    auto old_entry = entry(page_id);
+    stored_units_ += count;
+    set_entry(page_id, ALLOCATED | count | (first << FIRST_UNIT_SHIFT));
+    free_slot(old_entry);
+}
+
+void CompressedStorage::read_pages(const std::vector<page_id_t> &page_ids, const std::vector<char *> &pages_data) {
+    assert(page_ids.size() == pages_data.size());
+    for (size_t i = 0; i < page_ids.size(); ++i) {
+        read_page(page_ids[i], pages_data[i]);
+    }
+}
+
+void CompressedStorage::write_pages(const std::vector<page_id_t> &page_ids,
+                                    const std::vector<const char *> &pages_data) {
+    assert(page_ids.size() == pages_data.size());
+    for (size_t i = 0; i < page_ids.size(); ++i) {
+        write_page(page_ids[i], pages_data[i]);
+    }
+}
+
+CompressedStorage::io_ticket_t CompressedStorage::submit(IoRequest *requests, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        auto &request = requests[i];
+        try {
+            if (request.write_) {
+                write_page(request.page_id_, request.data_);
+            } else {
+                read_page(request.page_id_, request.data_);
+            }
+            request.succeeded_ = true;
+        } catch (const IOException &) {
+            request.succeeded_ = false;
+        }
+    }
+    return next_ticket_.fetch_add(1);
+}
+
+bool CompressedStorage::page_allocated(page_id_t page_id) {
+    std::scoped_lock latch(latch_);
+    return page_id >= 0 && page_id < next_page_id_ && (map_[page_id] & ALLOCATED);
+}
+
+size_t CompressedStorage::stored_bytes() {
+    std::scoped_lock latch(latch_);
+    return stored_units_ * UNIT_SIZE;
+}
+
+uint64_t CompressedStorage::entry(page_id_t page_id) {
+    if (page_id < 0 || page_id >= next_page_id_ || !(map_[page_id] & ALLOCATED)) {
+        throw IOException(fmt::format("I/O error accessing unallocated page (page_id = {})", page_id));
+    }
+    return map_[page_id];
+}
+
+void CompressedStorage::set_entry(page_id_t page_id, uint64_t entry) {
+    map_[page_id] = entry;
+    size_t map_page = page_id / ENTRIES_PER_MAP_PAGE;
+    read_or_write_all(map_fd_,
+                      reinterpret_cast<char *>(map_.data() + map_page * ENTRIES_PER_MAP_PAGE),
+                      PAGE_SIZE,
+                      map_page * PAGE_SIZE,
+                      true);
+}
+
+uint64_t CompressedStorage::alloc_slot(size_t units) {
+    auto fit = free_extents_by_size_.lower_bound({units, 0});
+    if (fit == free_extents_by_size_.end()) {
+        auto first = end_unit_;
+        end_unit_ += units;
+        return first;
+    }
+    auto [size, first] = *fit;
+    erase_free_extent(free_extents_.find(first));
+    // the rest of the extent is still surrounded by units in use
+    if (size > units) {
+        free_extents_.emplace(first + units, size - units);
+        free_extents_by_size_.emplace(size - units, first + units);
+    }
+    return first;
+}
+
+void CompressedStorage::free_slot(uint64_t entry) {
+    if (units(entry) == 0) {
+        return;
+    }
+    add_free_units(first_unit(entry), units(entry));
+    stored_units_ -= units(entry);
+}
+
+void CompressedStorage::add_free_units(uint64_t first_unit, uint64_t units) {
+    if (units == 0) {
+        return;
+    }
+    auto next = free_extents_.lower_bound(first_unit);
+    if (next != free_extents_.end() && next->first == first_unit + units) {
+        units += next->second;
+        next = erase_free_extent(next);
+    }
+    if (next != free_extents_.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == first_unit) {
+            first_unit = prev->first;
+            units += prev->second;
+            erase_free_extent(prev);
+        }
+    }
+    free_extents_.emplace(first_unit, units);
+    free_extents_by_size_.emplace(units, first_unit);
+}
+
+std::map<uint64_t, uint64_t>::iterator CompressedStorage::erase_free_extent(
+    std::map<uint64_t, uint64_t>::iterator extent) {
+    free_extents_by_size_.erase({extent->second, extent->first});
+    return free_extents_.erase(extent);
+}
+}  // namespace naivedb::io
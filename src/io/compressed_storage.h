@@ -0,0 +1,177 @@
+#pragma once
+
+#include "common/constants.h"
+#include "common/macros.h"
+#include "common/types.h"
+#include "io/storage.h"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace naivedb::io {
+/**
+ * @brief CompressedStorage stores each page compressed in a slot of whole 512-byte units of a data file, so that
+ * compressible pages take less I/O and less space. The pages read and written through it are plain pages.
+ *
+ * A map file next to the data file holds an 8-byte entry for each page id:
+ *  ---------------------------------------------------------
+ * | first unit of the slot (59) | allocated (1) | units (4) |
+ *  ---------------------------------------------------------
+ * A page that is allocated but has no slot reads as zeros, and a page stored in 8 units is not compressed. A
+ * compressed slot starts with the 2-byte size of the compressed page.
+ *
+ * A page is never overwritten in place: a write puts the page in a free slot, then writes the map page holding its
+ * entry, then frees the old slot. Both files are opened with O_DSYNC, so the map only ever points to complete slots.
+ * The free slots are only kept in memory; they are the gaps between the slots of the map when the files are opened.
+ * A freed slot is merged with the free units around it, and a slot is taken from the smallest free extent that fits,
+ * so that churn does not cut the free space into pieces too small to use. The slots taken by writes in progress are
+ * not in the map yet, so they are tracked apart until their entries are set.
+ */
+class CompressedStorage : public Storage {
+    DISALLOW_COPY_AND_MOVE(CompressedStorage)
+
+  public:
+    /**
+     * @brief Open or create a compressed page store.
+     *
+     * @param file_name the data file. The map file is the same file name followed by ".map".
+     */
+    explicit CompressedStorage(std::string_view file_name);
+
+    ~CompressedStorage() override;
+
+    page_id_t alloc_page() override;
+
+    void free_page(page_id_t page_id) override;
+
+    page_id_t lowest_free_page_id() override;
+
+    /**
+     * @brief Truncate the data file after the last slot in use.
+     *
+     * @return size_t the number of bytes the data file has shrunk by
+     */
+    size_t truncate_free_tail() override;
+
+    void read_page(page_id_t page_id, char *page_data) override;
+
+    void write_page(page_id_t page_id, const char *page_data) override;
+
+    void read_page_aligned(page_id_t page_id, char *page_data) override { read_page(page_id, page_data); }
+
+    void write_page_aligned(page_id_t page_id, const char *page_data) override { write_page(page_id, page_data); }
+
+    void read_pages(const std::vector<page_id_t> &page_ids, const std::vector<char *> &pages_data) override;
+
+    void write_pages(const std::vector<page_id_t> &page_ids, const std::vector<const char *> &pages_data) override;
+
+    /**
+     * @brief Perform a batch of page reads and writes right away.
+     *
+     * @param requests
+     * @param count
+     * @return io_ticket_t
+     */
+    io_ticket_t submit(IoRequest *requests, size_t count) override;
+
+    void wait(io_ticket_t) override {}
+
+    bool page_allocated(page_id_t page_id) override;
+
+    /**
+     * @brief Get the number of bytes of the slots in use, which is what the pages take on disk.
+     *
+     * @return size_t
+     */
+    size_t stored_bytes();
+
+  private:
+    static constexpr size_t UNIT_SIZE = 512;
+    static constexpr size_t UNITS_PER_PAGE = PAGE_SIZE / UNIT_SIZE;
+    static constexpr size_t ENTRIES_PER_MAP_PAGE = PAGE_SIZE / sizeof(uint64_t);
+    static constexpr uint64_t UNITS_MASK = 0xf;
+    static constexpr uint64_t ALLOCATED = 1 << 4;
+    static constexpr unsigned FIRST_UNIT_SHIFT = 5;
+
+    static size_t units(uint64_t entry) { return entry & UNITS_MASK; }
+    static uint64_t first_unit(uint64_t entry) { return entry >> FIRST_UNIT_SHIFT; }
+
+    /**
+     * @brief Get the map entry of an allocated page. The latch must be held.
+     *
+     * @param page_id
+     * @return uint64_t
+     */
+    uint64_t entry(page_id_t page_id);
+
+    /**
+     * @brief Set the map entry of a page and write the map page holding it. The latch must be held.
+     *
+     * @param page_id
+     * @param entry
+     */
+    void set_entry(page_id_t page_id, uint64_t entry);
+
+    /**
+     * @brief Take a slot from the smallest free extent that fits, or extend the data file if none does. The latch
+     * must be held.
+     *
+     * @param units
+     * @return uint64_t the first unit of the slot
+     */
+    uint64_t alloc_slot(size_t units);
+
+    /**
+     * @brief Return the slot of a map entry to the free slots. The latch must be held.
+     *
+     * @param entry
+     */
+    void free_slot(uint64_t entry);
+
+    /**
+     * @brief Add a range of free units to the free extents, merging it with the free units just before and after it.
+     * The latch must be held.
+     *
+     * @param first_unit
+     * @param units
+     */
+    void add_free_units(uint64_t first_unit, uint64_t units);
+
+    /**
+     * @brief Remove a free extent. The latch must be held.
+     *
+     * @param extent
+     * @return std::map<uint64_t, uint64_t>::iterator the free extent after it
+     */
+    std::map<uint64_t, uint64_t>::iterator erase_free_extent(std::map<uint64_t, uint64_t>::iterator extent);
+
+    std::string file_name_;
+    int data_fd_;
+    int map_fd_;
+
+    std::mutex latch_;
+    // the entries of all the page ids, in whole map pages
+    std::vector<uint64_t> map_;
+    // the page ids below next_page_id_ which are not allocated
+    std::set<page_id_t> free_page_ids_;
+    page_id_t next_page_id_;
+    // the free extents by their first unit, which are never adjacent to each other
+    std::map<uint64_t, uint64_t> free_extents_;
+    // the free extents by size, then by first unit
+    std::set<std::pair<uint64_t, uint64_t>> free_extents_by_size_;
+    // the units of the data file after the last slot in use or free
+    uint64_t end_unit_;
+    // the ends of the slots taken by writes whose map entries are not set yet, which the truncation must keep
+    std::multiset<uint64_t> slot_ends_in_flight_;
+    size_t stored_units_;
+
+    std::atomic<io_ticket_t> next_ticket_;
+};
+}  // namespace naivedb::io
@@ -5,14 +5,24 @@
 #include "common/format.h"
 #include "common/types.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
 #include <cstring>
 #include <fcntl.h>
+#include <numeric>
 #include <sys/stat.h>
 #include <unistd.h>
 
 namespace naivedb::io {
-DiskManager::DiskManager(std::string_view file_name) : file_name_(file_name), master_page_{}, header_pages_{} {
+namespace {
+alignas(PAGE_SIZE) const char ZERO_PAGE[PAGE_SIZE] = {};
+}  // namespace
+
+DiskManager::DiskManager(std::string_view file_name, IoBackend backend)
+    : file_name_(file_name), master_page_{}, header_pages_{}, free_word_hints_{}, non_full_headers_{} {
     fd_ = open(file_name.data(), O_DIRECT | O_SYNC | O_RDWR);
     // directory or file does not exist
     if (fd_ < 0) {
@@ -26,52 +36,54 @@ DiskManager::DiskManager(std::string_view file_name) : file_name_(file_name), ma
         }
         flush_master_page();
     } else {
+        // the header pages are read on first access
         read_master_page();
-        size_t max_header_index = -1;
-        for (size_t i = MAX_HEADER_PAGES - 1; i >= 0; --i) {
-            if (master_page_[i] > 0) {
-                max_header_index = i;
-                break;
-            }
-        }
-        for (size_t i = 0; i <= max_header_index; ++i) {
-            read_header_page(i);
-        }
+    }
+    file_end_ = fresh_offset_ = file_size();
+    for (size_t i = 0; i < MAX_HEADER_PAGES; ++i) {
+        set_header_full(i, master_page_[i] == DATA_PAGES_PER_HEADER);
+    }
+    if (backend == IoBackend::IoUring) {
+        io_uring_ = IoUring::create(IO_URING_ENTRIES);
     }
 }
 
 DiskManager::~DiskManager() { close(fd_); }
 
-page_id_t DiskManager::alloc_page() {
+page_id_t DiskManager::alloc_page() { return alloc_pages(1); }
+
+page_id_t DiskManager::alloc_pages(size_t count) {
+    assert(count > 0 && count <= DATA_PAGES_PER_HEADER);
     std::scoped_lock latch(latch_);
-    size_t header_index;
-    for (header_index = 0; header_index < MAX_HEADER_PAGES; ++header_index) {
-        if (master_page_[header_index] < DATA_PAGES_PER_HEADER) {
+    size_t header_index, page_index = DATA_PAGES_PER_HEADER;
+    for (header_index = find_non_full_header(0); header_index < MAX_HEADER_PAGES;
+         header_index = find_non_full_header(header_index + 1)) {
+        if (static_cast<size_t>(DATA_PAGES_PER_HEADER - master_page_[header_index]) < count) {
+            continue;
+        }
+        // loading the header page may correct its page count
+        header_page(header_index);
+        if (static_cast<size_t>(DATA_PAGES_PER_HEADER - master_page_[header_index]) < count) {
+            continue;
+        }
+        page_index = count == 1 ? find_free_page(header_index) : find_free_run(header_index, count);
+        if (page_index != DATA_PAGES_PER_HEADER) {
             break;
         }
     }
-    assert(header_index != MAX_HEADER_PAGES);
-
-    size_t page_index;
-    if (!header_pages_[header_index]) {
-        page_index = 0;
-        header_pages_[header_index] = std::make_unique<char[]>(PAGE_SIZE);
-        set_bit(header_pages_[header_index].get(), 0);
-    } else {
-        for (page_index = 0; page_index < DATA_PAGES_PER_HEADER; ++page_index) {
-            if (!bit(header_pages_[header_index].get(), page_index)) {
-                set_bit(header_pages_[header_index].get(), page_index);
-                break;
-            }
-        }
-        assert(page_index != DATA_PAGES_PER_HEADER);
+    if (header_index == MAX_HEADER_PAGES) {
+        throw IOException(fmt::format("cannot allocate {} contiguous pages", count));
     }
+
     page_id_t page_id = header_index * DATA_PAGES_PER_HEADER + page_index;
-    char zeros[PAGE_SIZE] = {0};
-    write_page_with_offset(page_id_to_offset(page_id), zeros);
-    ++master_page_[header_index];
-    flush_master_page();
+    zero_pages(page_id_to_offset(page_id), count);
+    for (size_t i = 0; i < count; ++i) {
+        set_bit(header_page(header_index), page_index + i);
+    }
+    master_page_[header_index] += count;
+    set_header_full(header_index, master_page_[header_index] == DATA_PAGES_PER_HEADER);
     flush_header_page(header_index);
+    flush_master_page();
     return page_id;
 }
 
@@ -80,36 +92,273 @@ void DiskManager::free_page(page_id_t page_id) {
     size_t header_index = page_id / DATA_PAGES_PER_HEADER;
     size_t page_index = page_id % DATA_PAGES_PER_HEADER;
 
-    if (!header_pages_[header_index]) {
+    if (master_page_[header_index] == 0) {
         throw IOException(fmt::format("cannot free unallocated page (page_id = {})", page_id));
     }
-    if (!bit(header_pages_[header_index].get(), page_index)) {
+    if (!bit(header_page(header_index), page_index)) {
         throw IOException(fmt::format("cannot free unallocated page (page_id = {})", page_id));
     }
-    clear_bit(header_pages_[header_index].get(), page_index);
+    clear_bit(header_page(header_index), page_index);
+    free_word_hints_[header_index] =
+        std::min<uint16_t>(free_word_hints_[header_index], static_cast<uint16_t>(page_index / BITMAP_WORD_BITS));
+    set_header_full(header_index, false);
     --master_page_[header_index];
-    flush_master_page();
     flush_header_page(header_index);
+    flush_master_page();
+    // give the space back to the file system. The page reads as zeros afterwards, and the file system may not support
+    // punching holes, so a failure is harmless.
+    fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, page_id_to_offset(page_id), PAGE_SIZE);
 }
 
-void DiskManager::read_page(page_id_t page_id, char *page_data) {
+page_id_t DiskManager::lowest_free_page_id() {
     std::scoped_lock latch(latch_);
+    for (auto header_index = find_non_full_header(0); header_index < MAX_HEADER_PAGES;
+         header_index = find_non_full_header(header_index + 1)) {
+        // loading the header page may correct its page count
+        header_page(header_index);
+        if (master_page_[header_index] < DATA_PAGES_PER_HEADER) {
+            return header_index * DATA_PAGES_PER_HEADER + find_free_page(header_index);
+        }
+    }
+    return INVALID_PAGE_ID;
+}
+
+size_t DiskManager::truncate_free_tail() {
+    std::scoped_lock latch(latch_);
+    // the file must keep the master page, and the last allocated page if there is one
+    size_t end = PAGE_SIZE;
+    for (size_t header_index = MAX_HEADER_PAGES; header_index-- > 0;) {
+        if (master_page_[header_index] == 0) {
+            continue;
+        }
+        auto header = header_page(header_index);
+        size_t word_index = WORDS_PER_HEADER;
+        while (word_index-- > 0 && bitmap_word(header, word_index) == 0) {
+        }
+        if (word_index < WORDS_PER_HEADER) {
+            auto word = bitmap_word(header, word_index);
+            size_t page_index = word_index * BITMAP_WORD_BITS + BITMAP_WORD_BITS - 1 - __builtin_clzll(word);
+            end = page_id_to_offset(header_index * DATA_PAGES_PER_HEADER + page_index) + PAGE_SIZE;
+            break;
+        }
+    }
+    auto size = file_size();
+    if (end >= size) {
+        return 0;
+    }
+    if (ftruncate(fd_, end) < 0) {
+        throw IOException(fmt::format("cannot truncate file {} to {} bytes", file_name_, end));
+    }
+    file_end_ = fresh_offset_ = end;
+    return size - end;
+}
+
+void DiskManager::read_page(page_id_t page_id, char *page_data) {
     read_page_with_offset(page_id_to_offset(page_id), page_data);
 }
 
 void DiskManager::write_page(page_id_t page_id, const char *page_data) {
-    std::scoped_lock latch(latch_);
     write_page_with_offset(page_id_to_offset(page_id), page_data);
 }
 
+void DiskManager::read_page_aligned(page_id_t page_id, char *page_data) {
+    if (io_uring_) {
+        read_or_write_aligned(page_id, page_data, false);
+        return;
+    }
+    read_aligned_page_with_offset(page_id_to_offset(page_id), page_data);
+}
+
+void DiskManager::write_page_aligned(page_id_t page_id, const char *page_data) {
+    if (io_uring_) {
+        read_or_write_aligned(page_id, const_cast<char *>(page_data), true);
+        return;
+    }
+    write_aligned_page_with_offset(page_id_to_offset(page_id), page_data);
+}
+
+void DiskManager::read_pages(const std::vector<page_id_t> &page_ids, const std::vector<char *> &pages_data) {
+    assert(page_ids.size() == pages_data.size());
+    read_or_write_pages(page_ids, pages_data.data(), false);
+}
+
+void DiskManager::write_pages(const std::vector<page_id_t> &page_ids, const std::vector<const char *> &pages_data) {
+    assert(page_ids.size() == pages_data.size());
+    read_or_write_pages(page_ids, const_cast<char *const *>(pages_data.data()), true);
+}
+
+DiskManager::io_ticket_t DiskManager::submit(IoRequest *requests, size_t count) {
+    // the reads and the writes are cut into runs of adjacent pages, each transferred by one vectored operation
+    IoBatch batch{requests, {}, {}, {}};
+    for (bool write : {false, true}) {
+        std::vector<page_id_t> page_ids;
+        std::vector<char *> pages_data;
+        std::vector<size_t> request_indexes;
+        for (size_t i = 0; i < count; ++i) {
+            if (requests[i].write_ == write) {
+                page_ids.emplace_back(requests[i].page_id_);
+                pages_data.emplace_back(requests[i].data_);
+                request_indexes.emplace_back(i);
+            }
+        }
+        if (io_uring_) {
+            for_each_run(page_ids,
+                         pages_data.data(),
+                         [&](size_t offset, std::vector<iovec> &iovecs, const std::vector<size_t> &indexes) {
+                             batch.operations_.push_back({write, fd_, nullptr, 0, offset, 0});
+                             batch.iovecs_.emplace_back(iovecs);
+                             auto &run_requests = batch.request_indexes_.emplace_back();
+                             for (auto index : indexes) {
+                                 run_requests.emplace_back(request_indexes[index]);
+                             }
+                         });
+            continue;
+        }
+        bool succeeded = true;
+        try {
+            read_or_write_pages(page_ids, pages_data.data(), write);
+        } catch (const IOException &) {
+            succeeded = false;
+        }
+        for (auto index : request_indexes) {
+            requests[index].succeeded_ = succeeded;
+        }
+    }
+
+    if (io_uring_) {
+        // the buffers of the vectors stay in place when the batch is moved
+        for (size_t i = 0; i < batch.operations_.size(); ++i) {
+            batch.operations_[i].iovecs_ = batch.iovecs_[i].data();
+            batch.operations_[i].iovcnt_ = batch.iovecs_[i].size();
+        }
+        auto ticket = io_uring_->submit(batch.operations_.data(), batch.operations_.size());
+        std::scoped_lock latch(batches_latch_);
+        batches_.emplace(ticket, std::move(batch));
+        return ticket;
+    }
+    // retry the pages one by one if a vectored transfer has failed
+    for (size_t i = 0; i < count; ++i) {
+        auto &request = requests[i];
+        if (request.succeeded_) {
+            continue;
+        }
+        try {
+            if (request.write_) {
+                write_page_aligned(request.page_id_, request.data_);
+            } else {
+                read_page_aligned(request.page_id_, request.data_);
+            }
+            request.succeeded_ = true;
+        } catch (const IOException &) {
+            request.succeeded_ = false;
+        }
+    }
+    return 0;
+}
+
+void DiskManager::wait(io_ticket_t ticket) {
+    if (!io_uring_) {
+        return;
+    }
+    io_uring_->wait(ticket);
+    IoBatch batch;
+    {
+        std::scoped_lock latch(batches_latch_);
+        auto iter = batches_.find(ticket);
+        batch = std::move(iter->second);
+        batches_.erase(iter);
+    }
+    for (size_t i = 0; i < batch.operations_.size(); ++i) {
+        // after a short transfer, only the pages transferred completely have succeeded
+        auto &run_requests = batch.request_indexes_[i];
+        for (size_t j = 0; j < run_requests.size(); ++j) {
+            batch.requests_[run_requests[j]].succeeded_ =
+                batch.operations_[i].result_ >= static_cast<int64_t>((j + 1) * PAGE_SIZE);
+        }
+    }
+}
+
+void DiskManager::read_or_write_aligned(page_id_t page_id, char *page_data, bool write) {
+    assert(reinterpret_cast<uintptr_t>(page_data) % PAGE_SIZE == 0);
+    IoUring::Operation operation{write, fd_, page_data, PAGE_SIZE, page_id_to_offset(page_id), 0};
+    io_uring_->wait(io_uring_->submit(&operation, 1));
+    if (operation.result_ != static_cast<int64_t>(PAGE_SIZE)) {
+        throw IOException(fmt::format("I/O error while {} page {} (result = {})",
+                                      write ? "writing" : "reading",
+                                      page_id,
+                                      operation.result_));
+    }
+}
+
+void DiskManager::read_or_write_pages(const std::vector<page_id_t> &page_ids, char *const *pages_data, bool write) {
+    for_each_run(page_ids, pages_data, [&](size_t offset, std::vector<iovec> &iovecs, const std::vector<size_t> &) {
+        read_or_write_run(offset, iovecs, write);
+    });
+}
+
+template <typename OnRun>
+void DiskManager::for_each_run(const std::vector<page_id_t> &page_ids, char *const *pages_data, OnRun &&on_run) {
+    std::vector<size_t> order(page_ids.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return page_ids[a] < page_ids[b]; });
+
+    std::vector<iovec> iovecs;
+    std::vector<size_t> indexes;
+    for (size_t i = 0; i < order.size();) {
+        // pages with consecutive ids are adjacent in the file unless a header page lies between them
+        auto offset = page_id_to_offset(page_ids[order[i]]);
+        auto next_offset = offset;
+        iovecs.clear();
+        indexes.clear();
+        while (i < order.size() && iovecs.size() < IOV_MAX && page_id_to_offset(page_ids[order[i]]) == next_offset) {
+            assert(reinterpret_cast<uintptr_t>(pages_data[order[i]]) % PAGE_SIZE == 0);
+            iovecs.push_back({pages_data[order[i]], PAGE_SIZE});
+            indexes.emplace_back(order[i]);
+            next_offset += PAGE_SIZE;
+            ++i;
+        }
+        on_run(offset, iovecs, indexes);
+    }
+}
+
+void DiskManager::read_or_write_run(size_t offset, std::vector<iovec> &iovecs, bool write) {
+    auto iov = iovecs.data();
+    int iovcnt = static_cast<int>(iovecs.size());
+    while (iovcnt > 0) {
+        auto transferred = write ? pwritev(fd_, iov, iovcnt, offset) : preadv(fd_, iov, iovcnt, offset);
+        if (transferred < 0 && errno == EINTR) {
+            continue;
+        }
+        if (transferred < 0) {
+            throw IOException(fmt::format("I/O error while {}", write ? "writing" : "reading"));
+        }
+        if (transferred == 0) {
+            throw IOException(
+                fmt::format("I/O error {} past EOF (offset = {})", write ? "writing" : "reading", offset));
+        }
+        offset += transferred;
+        for (auto remaining = static_cast<size_t>(transferred); remaining > 0;) {
+            if (remaining >= iov->iov_len) {
+                remaining -= iov->iov_len;
+                ++iov;
+                --iovcnt;
+            } else {
+                iov->iov_base = static_cast<char *>(iov->iov_base) + remaining;
+                iov->iov_len -= remaining;
+                remaining = 0;
+            }
+        }
+    }
+}
+
 bool DiskManager::page_allocated(page_id_t page_id) {
     std::scoped_lock latch(latch_);
     size_t header_index = page_id / DATA_PAGES_PER_HEADER;
     size_t page_index = page_id % DATA_PAGES_PER_HEADER;
-    if (header_pages_[header_index]) {
-        return bit(header_pages_[header_index].get(), page_index);
+    if (master_page_[header_index] == 0) {
+        return false;
     }
-    return false;
+    return bit(header_page(header_index), page_index);
 }
 
 size_t DiskManager::file_size() {
@@ -124,13 +373,7 @@ void DiskManager::read_page_with_offset(size_t offset, char *page_data) {
     // the read buffer must be block-aligned if the file is opened with O_DIRECT
     char aligned_buffer[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE))) = {0};
 
-    if (auto file_size = this->file_size(); offset >= file_size) {
-        throw IOException(fmt::format("I/O error reading past EOF (offset = {}, file_size = {})", offset, file_size));
-    }
-    lseek(fd_, offset, SEEK_SET);
-    if (read(fd_, aligned_buffer, PAGE_SIZE) < 0) {
-        throw IOException("I/O error while reading");
-    }
+    read_aligned_page_with_offset(offset, aligned_buffer);
     std::memcpy(page_data, aligned_buffer, PAGE_SIZE);
 }
 
@@ -138,9 +381,24 @@ void DiskManager::write_page_with_offset(size_t offset, const char *page_data) {
     // the write buffer must be block-aligned if the file is opened with O_DIRECT
     char aligned_buffer[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE))) = {0};
 
-    lseek(fd_, offset, SEEK_SET);
     std::memcpy(aligned_buffer, page_data, PAGE_SIZE);
-    if (write(fd_, aligned_buffer, PAGE_SIZE) < 0) {
+    write_aligned_page_with_offset(offset, aligned_buffer);
+}
+
+void DiskManager::read_aligned_page_with_offset(size_t offset, char *page_data) {
+    assert(reinterpret_cast<uintptr_t>(page_data) % PAGE_SIZE == 0);
+    if (auto file_size = this->file_size(); offset >= file_size) {
+        throw IOException(fmt::format("I/O error reading past EOF (offset = {}, file_size = {})", offset, file_size));
+    }
+    // positional I/O leaves the file offset alone, so concurrent reads and writes need no latch
+    if (pread(fd_, page_data, PAGE_SIZE, offset) != static_cast<ssize_t>(PAGE_SIZE)) {
+        throw IOException("I/O error while reading");
+    }
+}
+
+void DiskManager::write_aligned_page_with_offset(size_t offset, const char *page_data) {
+    assert(reinterpret_cast<uintptr_t>(page_data) % PAGE_SIZE == 0);
+    if (pwrite(fd_, page_data, PAGE_SIZE, offset) != static_cast<ssize_t>(PAGE_SIZE)) {
         throw IOException("I/O error while writing");
     }
 }
@@ -155,6 +413,102 @@ void DiskManager::set_bit(char *bitmap, size_t i) { bitmap[i / 8] |= (1 << (i %
 
 void DiskManager::clear_bit(char *bitmap, size_t i) { bitmap[i / 8] &= ~(1 << (i % 8)); }
 
+uint64_t DiskManager::bitmap_word(const char *bitmap, size_t word_index) {
+    uint64_t word;
+    std::memcpy(&word, bitmap + word_index * sizeof(word), sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+size_t DiskManager::find_non_full_header(size_t from) {
+    for (size_t i = from / BITMAP_WORD_BITS; i < MAX_HEADER_PAGES / BITMAP_WORD_BITS; ++i) {
+        auto word = non_full_headers_[i];
+        if (i == from / BITMAP_WORD_BITS) {
+            // ignore the header pages before from
+            word &= ~uint64_t(0) << (from % BITMAP_WORD_BITS);
+        }
+        if (word != 0) {
+            return i * BITMAP_WORD_BITS + __builtin_ctzll(word);
+        }
+    }
+    return MAX_HEADER_PAGES;
+}
+
+size_t DiskManager::find_free_page(size_t header_index) {
+    auto bitmap = header_pages_[header_index].get();
+    for (size_t i = free_word_hints_[header_index]; i < WORDS_PER_HEADER; ++i) {
+        if (auto free_bits = ~bitmap_word(bitmap, i); free_bits != 0) {
+            free_word_hints_[header_index] = static_cast<uint16_t>(i);
+            return i * BITMAP_WORD_BITS + __builtin_ctzll(free_bits);
+        }
+    }
+    assert(false);
+    return DATA_PAGES_PER_HEADER;
+}
+
+size_t DiskManager::find_free_run(size_t header_index, size_t count) {
+    auto bitmap = header_pages_[header_index].get();
+    size_t run_start = 0, run_length = 0;
+    for (size_t i = free_word_hints_[header_index]; i < WORDS_PER_HEADER; ++i) {
+        auto word = bitmap_word(bitmap, i);
+        if (word == ~uint64_t(0)) {
+            run_length = 0;
+            continue;
+        }
+        if (word == 0 && run_length + BITMAP_WORD_BITS < count) {
+            run_start = run_length == 0 ? i * BITMAP_WORD_BITS : run_start;
+            run_length += BITMAP_WORD_BITS;
+            continue;
+        }
+        for (size_t j = 0; j < BITMAP_WORD_BITS; ++j) {
+            if (word >> j & 1) {
+                run_length = 0;
+                continue;
+            }
+            run_start = run_length == 0 ? i * BITMAP_WORD_BITS + j : run_start;
+            if (++run_length == count) {
+                return run_start;
+            }
+        }
+    }
+    return DATA_PAGES_PER_HEADER;
+}
+
+void DiskManager::set_header_full(size_t header_index, bool full) {
+    auto mask = uint64_t(1) << (header_index % BITMAP_WORD_BITS);
+    if (full) {
+        non_full_headers_[header_index / BITMAP_WORD_BITS] &= ~mask;
+    } else {
+        non_full_headers_[header_index / BITMAP_WORD_BITS] |= mask;
+    }
+}
+
+void DiskManager::zero_pages(size_t offset, size_t count) {
+    auto end = offset + count * PAGE_SIZE;
+    if (end > file_end_) {
+        // grow the file by whole extents, so that a bulk load does not extend it page by page. The extension must be
+        // durable before the pages are marked as allocated.
+        auto new_end = std::max(end, file_end_ + EXTENT_SIZE);
+        if (fallocate(fd_, 0, file_end_, new_end - file_end_) == 0 && fdatasync(fd_) == 0) {
+            file_end_ = new_end;
+        }
+    }
+    if (offset >= fresh_offset_ && end <= file_end_) {
+        fresh_offset_ = end;
+        return;
+    }
+    // the pages may hold the data of freed pages, or the file system cannot preallocate
+    std::vector<iovec> iovecs;
+    for (size_t i = 0; i < count; i += iovecs.size()) {
+        iovecs.assign(std::min<size_t>(count - i, IOV_MAX), {const_cast<char *>(ZERO_PAGE), PAGE_SIZE});
+        read_or_write_run(offset + i * PAGE_SIZE, iovecs, true);
+    }
+    file_end_ = std::max(file_end_, end);
+    fresh_offset_ = std::max(fresh_offset_, end);
+}
+
 void DiskManager::flush_master_page() { write_page_with_offset(0, reinterpret_cast<const char *>(master_page_)); }
 
 void DiskManager::flush_header_page(size_t index) {
@@ -163,6 +517,26 @@ void DiskManager::flush_header_page(size_t index) {
 
 void DiskManager::read_master_page() { read_page_with_offset(0, reinterpret_cast<char *>(master_page_)); }
 
+char *DiskManager::header_page(size_t index) {
+    if (header_pages_[index]) {
+        return header_pages_[index].get();
+    }
+    if (master_page_[index] == 0) {
+        // the header page has never been written, or all of its pages are free
+        header_pages_[index] = std::make_unique<char[]>(PAGE_SIZE);
+        return header_pages_[index].get();
+    }
+    read_header_page(index);
+    // the master page may lag behind the header page after a crash
+    size_t allocated = 0;
+    for (size_t i = 0; i < WORDS_PER_HEADER; ++i) {
+        allocated += __builtin_popcountll(bitmap_word(header_pages_[index].get(), i));
+    }
+    master_page_[index] = static_cast<uint16_t>(allocated);
+    set_header_full(index, allocated == DATA_PAGES_PER_HEADER);
+    return header_pages_[index].get();
+}
+
 void DiskManager::read_header_page(size_t index) {
     if (!header_pages_[index]) {
         header_pages_[index] = std::make_unique<char[]>(PAGE_SIZE);
@@ -4,6 +4,8 @@
 #include "common/exception.h"
 #include "common/macros.h"
 #include "common/types.h"
+#include "io/io_uring.h"
+#include "io/storage.h"
 
 #include <array>
 #include <cstdint>
@@ -11,9 +13,22 @@
 #include <mutex>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <sys/uio.h>
 #include <vector>
 
 namespace naivedb::io {
+/**
+ * @brief The ways DiskManager performs page I/O.
+ *
+ */
+enum class IoBackend {
+    // blocking system calls, one at a time
+    Sync,
+    // io_uring, which allows many reads and writes in flight. It falls back to Sync if the kernel lacks io_uring.
+    IoUring,
+};
+
 /**
  * @brief An implementation of a disk space manager with two levels of header pages, allowing for (with page size of 4K)
  * 256G worth of data at most.
@@ -35,7 +50,13 @@ namespace naivedb::io {
  * have a maximum of 2K * 32K = 64M data pages.
  *
  * Master and header pages are cached permanently in memory; changes to these are immediately flushed to disk. This
- * caching is done separately from the buffer manager's caching.
+ * caching is done separately from the buffer manager's caching. The master page is read when the file is opened, and
+ * each header page when it is first accessed, so opening a file takes the same time whatever its size.
+ *
+ * An allocation first makes the new data pages read as zeros, then writes the header page, then the master page. A
+ * crash can therefore only leave the master page behind the header pages, so the page count of a header page in the
+ * master page, and whether the header page is full, are recomputed from the header page when it is first loaded. The
+ * file grows in preallocated extents rather than page by page.
  *
  * The file should be stored in the following manner:
  * - the master page is the 0th page of the file
@@ -50,27 +71,45 @@ namespace naivedb::io {
  * | MasterPage | HeaderPage_0 | DataPage_0 | ... | DataPage_31 | HeaderPage_1 | DataPage_32 | ... |
  *  -----------------------------------------------------------------------------------------------
  */
-class DiskManager {
+class DiskManager : public Storage {
     DISALLOW_COPY_AND_MOVE(DiskManager)
 
   public:
-    explicit DiskManager(std::string_view file_name);
+    explicit DiskManager(std::string_view file_name, IoBackend backend = IoBackend::Sync);
 
-    ~DiskManager();
+    ~DiskManager() override;
 
     /**
      * @brief Allocate a new page
      *
      * @return page_id_t
      */
-    page_id_t alloc_page();
+    page_id_t alloc_page() override;
 
     /**
-     * @brief Deallocate a page
+     * @brief Allocate a run of pages with consecutive ids, which are adjacent in the file. The allocation bitmap and the
+     * master page are written once for the whole run.
+     *
+     * @param count at most the number of data pages managed by a header page
+     * @return page_id_t the id of the first page
+     */
+    page_id_t alloc_pages(size_t count);
+
+    /**
+     * @brief Deallocate a page, and punch a hole in the file where it was, so that the file system can reuse its space.
      *
      * @param page_id
      */
-    void free_page(page_id_t page_id);
+    void free_page(page_id_t page_id) override;
+
+    page_id_t lowest_free_page_id() override;
+
+    /**
+     * @brief Truncate the file after the last allocated page. The pages after it are free and hold no data.
+     *
+     * @return size_t the number of bytes the file has shrunk by
+     */
+    size_t truncate_free_tail() override;
 
     /**
      * @brief Read data from a page
@@ -78,7 +117,7 @@ class DiskManager {
      * @param page_id
      * @param page_data
      */
-    void read_page(page_id_t page_id, char *page_data);
+    void read_page(page_id_t page_id, char *page_data) override;
 
     /**
      * @brief Write data to a page
@@ -86,7 +125,67 @@ class DiskManager {
      * @param page_id
      * @param page_data
      */
-    void write_page(page_id_t page_id, const char *page_data);
+    void write_page(page_id_t page_id, const char *page_data) override;
+
+    /**
+     * @brief Read data from a page straight into the given memory, without copying it through an aligned buffer
+     *
+     * @param page_id
+     * @param page_data must be aligned to PAGE_SIZE
+     */
+    void read_page_aligned(page_id_t page_id, char *page_data) override;
+
+    /**
+     * @brief Write data to a page straight from the given memory, without copying it through an aligned buffer
+     *
+     * @param page_id
+     * @param page_data must be aligned to PAGE_SIZE
+     */
+    void write_page_aligned(page_id_t page_id, const char *page_data) override;
+
+    /**
+     * @brief Read a batch of pages. The pages are sorted by their position in the file, and each run of adjacent pages
+     * is read with a single system call.
+     *
+     * @param page_ids
+     * @param pages_data the memory to read each page into, which must be aligned to PAGE_SIZE
+     */
+    void read_pages(const std::vector<page_id_t> &page_ids, const std::vector<char *> &pages_data) override;
+
+    /**
+     * @brief Write a batch of pages. The pages are sorted by their position in the file, and each run of adjacent
+     * pages is written with a single system call.
+     *
+     * @param page_ids
+     * @param pages_data the memory to write each page from, which must be aligned to PAGE_SIZE
+     */
+    void write_pages(const std::vector<page_id_t> &page_ids, const std::vector<const char *> &pages_data) override;
+
+    /**
+     * @brief Start a batch of page reads and writes, which may be performed in any order. With the io_uring backend the
+     * requests are in flight when this returns; with the synchronous backend they have already been performed, with
+     * adjacent pages coalesced as in read_pages() and write_pages().
+     *
+     * @param requests must stay alive until wait() returns for the ticket
+     * @param count
+     * @return io_ticket_t
+     */
+    io_ticket_t submit(IoRequest *requests, size_t count) override;
+
+    /**
+     * @brief Wait for a batch started by submit() and set the succeeded_ flags of its requests. Each ticket must be
+     * waited for exactly once.
+     *
+     * @param ticket
+     */
+    void wait(io_ticket_t ticket) override;
+
+    /**
+     * @brief Get the backend in use, which is Sync if IoUring was requested but is not supported.
+     *
+     * @return IoBackend
+     */
+    IoBackend backend() const { return io_uring_ ? IoBackend::IoUring : IoBackend::Sync; }
 
     /**
      * @brief Check whether the given page is allocated
@@ -95,16 +194,58 @@ class DiskManager {
      * @return true
      * @return false
      */
-    bool page_allocated(page_id_t page_id);
+    bool page_allocated(page_id_t page_id) override;
 
   private:
     static constexpr size_t MAX_HEADER_PAGES = 2048;
     static constexpr uint16_t DATA_PAGES_PER_HEADER = 32768;
+    static constexpr unsigned IO_URING_ENTRIES = 128;
+    static constexpr size_t BITMAP_WORD_BITS = 64;
+    static constexpr size_t WORDS_PER_HEADER = DATA_PAGES_PER_HEADER / BITMAP_WORD_BITS;
+    // the file is grown by at least this many bytes at a time
+    static constexpr size_t EXTENT_SIZE = 256 * PAGE_SIZE;
+
+    /**
+     * @brief The state of a batch submitted to io_uring.
+     *
+     */
+    struct IoBatch {
+        IoRequest *requests_;
+        // one operation for each run of adjacent pages, with the memory of its pages and the indexes of its requests
+        std::vector<IoUring::Operation> operations_;
+        std::vector<std::vector<iovec>> iovecs_;
+        std::vector<std::vector<size_t>> request_indexes_;
+    };
+
+    void read_or_write_aligned(page_id_t page_id, char *page_data, bool write);
+    void read_or_write_pages(const std::vector<page_id_t> &page_ids, char *const *pages_data, bool write);
+
+    /**
+     * @brief Sort pages by id and cut them into runs of pages adjacent in the file, of at most IOV_MAX pages each, so
+     * that each run can be transferred by one vectored read or write.
+     *
+     * @param page_ids
+     * @param pages_data the memory of the pages, aligned to PAGE_SIZE
+     * @param on_run called with the offset of each run, the memory of its pages and their indexes in page_ids
+     */
+    template <typename OnRun>
+    void for_each_run(const std::vector<page_id_t> &page_ids, char *const *pages_data, OnRun &&on_run);
+
+    /**
+     * @brief Read or write a run of adjacent pages with preadv() or pwritev(), resuming after partial transfers.
+     *
+     * @param offset the offset of the first page
+     * @param iovecs the memory of the pages, which is modified
+     * @param write
+     */
+    void read_or_write_run(size_t offset, std::vector<iovec> &iovecs, bool write);
 
     size_t file_size();
 
     void read_page_with_offset(size_t offset, char *page_data);
     void write_page_with_offset(size_t offset, const char *page_data);
+    void read_aligned_page_with_offset(size_t offset, char *page_data);
+    void write_aligned_page_with_offset(size_t offset, const char *page_data);
 
     size_t page_id_to_offset(page_id_t page_id);
 
@@ -112,18 +253,88 @@ class DiskManager {
     void set_bit(char *bitmap, size_t i);
     void clear_bit(char *bitmap, size_t i);
 
+    /**
+     * @brief Get 64 bits of a bitmap, with bit i of the word being bit 64 * word_index + i of the bitmap.
+     *
+     * @param bitmap
+     * @param word_index
+     * @return uint64_t
+     */
+    uint64_t bitmap_word(const char *bitmap, size_t word_index);
+
+    /**
+     * @brief Find the first header page with free data pages.
+     *
+     * @param from the index of the first header page to consider
+     * @return size_t the index of the header page, or MAX_HEADER_PAGES if there is none
+     */
+    size_t find_non_full_header(size_t from);
+
+    /**
+     * @brief Find the first free data page of a header page which is not full, starting from its hint.
+     *
+     * @param header_index
+     * @return size_t the index of the data page in the header page
+     */
+    size_t find_free_page(size_t header_index);
+
+    /**
+     * @brief Find the first run of free data pages of a header page.
+     *
+     * @param header_index
+     * @param count the length of the run
+     * @return size_t the index of the first data page of the run in the header page, or DATA_PAGES_PER_HEADER if there
+     * is none
+     */
+    size_t find_free_run(size_t header_index, size_t count);
+
+    void set_header_full(size_t header_index, bool full);
+
+    /**
+     * @brief Make newly allocated pages read as zeros. Pages that have never been written are zero already; the file is
+     * extended with fallocate() to cover them. Other pages are overwritten with zeros.
+     *
+     * @param offset the offset of the first page
+     * @param count
+     */
+    void zero_pages(size_t offset, size_t count);
+
     void flush_master_page();
     void flush_header_page(size_t index);
 
     void read_master_page();
     void read_header_page(size_t index);
 
+    /**
+     * @brief Get a header page, reading it from the file on first access.
+     *
+     * @param index
+     * @return char* the bitmap of the header page
+     */
+    char *header_page(size_t index);
+
     std::string file_name_;
     int fd_;
+    // the size of the file, including preallocated extents
+    size_t file_end_;
+    // the pages from this offset on have not been written since the file was opened
+    size_t fresh_offset_;
 
     uint16_t master_page_[MAX_HEADER_PAGES];
+    // null until first accessed
     std::unique_ptr<char[]> header_pages_[MAX_HEADER_PAGES];
 
+    // the index of the first bitmap word of each header page that may have a free bit. The words before it are full.
+    uint16_t free_word_hints_[MAX_HEADER_PAGES];
+    // a bitmap of the header pages that are not full, so that alloc_page() need not scan the master page
+    uint64_t non_full_headers_[MAX_HEADER_PAGES / BITMAP_WORD_BITS];
+
+    // protects the master and header pages. Data pages are read and written without it.
     std::mutex latch_;
+
+    // null if the synchronous backend is used
+    std::unique_ptr<IoUring> io_uring_;
+    std::mutex batches_latch_;
+    std::unordered_map<io_ticket_t, IoBatch> batches_;
 };
 }  // namespace naivedb::io
\ No newline at end of file
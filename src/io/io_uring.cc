@@ -0,0 +1,218 @@
+#include "io/io_uring.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace naivedb::io {
+namespace {
+int io_uring_setup(unsigned entries, io_uring_params *params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int io_uring_register(int ring_fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+bool supports(const io_uring_probe *probe, unsigned opcode) {
+    return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+}
+}  // namespace
+
+std::unique_ptr<IoUring> IoUring::create(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int ring_fd = io_uring_setup(entries, &params);
+    if (ring_fd < 0) {
+        return nullptr;
+    }
+    auto ring = std::unique_ptr<IoUring>(new IoUring(ring_fd));
+    if (!ring->map_rings(params.sq_entries, params.cq_entries, &params)) {
+        return nullptr;
+    }
+    // IORING_OP_READ and IORING_OP_WRITE are only available since Linux 5.6, which is also the first to support
+    // probing. The vectored operations are older.
+    constexpr unsigned PROBE_OPS = 256;
+    auto probe_buffer = std::make_unique<char[]>(sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op));
+    auto probe = reinterpret_cast<io_uring_probe *>(probe_buffer.get());
+    std::memset(probe, 0, sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op));
+    if (io_uring_register(ring_fd, IORING_REGISTER_PROBE, probe, PROBE_OPS) < 0 ||
+        !supports(probe, IORING_OP_READ) || !supports(probe, IORING_OP_WRITE)) {
+        return nullptr;
+    }
+    return ring;
+}
+
+IoUring::~IoUring() {
+    assert(pending_.empty());
+    if (sqes_) {
+        munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_) {
+        munmap(sq_ring_, sq_ring_size_);
+    }
+    close(ring_fd_);
+}
+
+bool IoUring::map_rings(unsigned sq_entries, unsigned cq_entries, const void *raw_params) {
+    auto params = static_cast<const io_uring_params *>(raw_params);
+    sq_ring_size_ = params->sq_off.array + sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params->cq_off.cqes + cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params->features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    auto map = [this](size_t size, off_t offset) -> void * {
+        void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, offset);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    };
+    if (!(sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING))) {
+        return false;
+    }
+    cq_ring_ = single_mmap ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+    if (!cq_ring_) {
+        return false;
+    }
+    sqes_size_ = sq_entries * sizeof(io_uring_sqe);
+    if (!(sqes_ = map(sqes_size_, IORING_OFF_SQES))) {
+        return false;
+    }
+
+    auto sq = static_cast<char *>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned *>(sq + params->sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params->sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned *>(sq + params->sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params->sq_off.array);
+    sq_entries_ = sq_entries;
+    auto cq = static_cast<char *>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params->cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params->cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned *>(cq + params->cq_off.ring_mask);
+    cqes_ = cq + params->cq_off.cqes;
+    return true;
+}
+
+IoUring::ticket_t IoUring::submit(Operation *operations, size_t count) {
+    std::unique_lock latch(latch_);
+    auto ticket = next_ticket_++;
+    pending_[ticket] = count;
+    for (size_t i = 0; i < count; ++i) {
+        // the completion queue is at least as large as the submission queue, so it never overflows
+        while (in_flight_ == sq_entries_) {
+            flush_submissions();
+            reap(latch);
+        }
+        auto &operation = operations[i];
+        tickets_[&operation] = ticket;
+        auto tail = *sq_tail_;
+        auto index = tail & sq_mask_;
+        auto &sqe = static_cast<io_uring_sqe *>(sqes_)[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.fd = operation.fd_;
+        if (operation.iovecs_) {
+            sqe.opcode = operation.write_ ? IORING_OP_WRITEV : IORING_OP_READV;
+            sqe.addr = reinterpret_cast<uint64_t>(operation.iovecs_);
+            sqe.len = static_cast<uint32_t>(operation.iovcnt_);
+        } else {
+            sqe.opcode = operation.write_ ? IORING_OP_WRITE : IORING_OP_READ;
+            sqe.addr = reinterpret_cast<uint64_t>(operation.data_);
+            sqe.len = static_cast<uint32_t>(operation.size_);
+        }
+        sqe.off = operation.offset_;
+        sqe.user_data = reinterpret_cast<uint64_t>(&operation);
+        sq_array_[index] = index;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        ++unsubmitted_;
+        ++in_flight_;
+    }
+    flush_submissions();
+    return ticket;
+}
+
+void IoUring::wait(ticket_t ticket) {
+    std::unique_lock latch(latch_);
+    while (pending_.at(ticket) > 0) {
+        reap(latch);
+    }
+    pending_.erase(ticket);
+}
+
+void IoUring::flush_submissions() {
+    while (unsubmitted_ > 0) {
+        int submitted = io_uring_enter(ring_fd_, unsubmitted_, 0, 0);
+        if (submitted < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                continue;
+            }
+            // the kernel rejected the whole submission, so complete the remaining operations with the error
+            auto error = errno;
+            auto tail = *sq_tail_;
+            for (unsigned i = unsubmitted_; i > 0; --i) {
+                auto &sqe = static_cast<io_uring_sqe *>(sqes_)[sq_array_[(tail - i) & sq_mask_]];
+                auto operation = reinterpret_cast<Operation *>(sqe.user_data);
+                operation->result_ = -error;
+                auto iter = tickets_.find(operation);
+                --pending_[iter->second];
+                tickets_.erase(iter);
+                --in_flight_;
+            }
+            // let the kernel skip the entries it has not consumed
+            __atomic_store_n(sq_tail_, tail - unsubmitted_, __ATOMIC_RELEASE);
+            unsubmitted_ = 0;
+            cv_.notify_all();
+            return;
+        }
+        unsubmitted_ -= submitted;
+    }
+}
+
+void IoUring::reap(std::unique_lock<std::mutex> &latch) {
+    if (reap_available()) {
+        cv_.notify_all();
+        return;
+    }
+    if (reaping_) {
+        cv_.wait(latch);
+        return;
+    }
+    reaping_ = true;
+    latch.unlock();
+    while (io_uring_enter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno == EINTR) {
+    }
+    latch.lock();
+    reaping_ = false;
+    reap_available();
+    cv_.notify_all();
+}
+
+bool IoUring::reap_available() {
+    auto head = *cq_head_;
+    auto tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        return false;
+    }
+    for (; head != tail; ++head) {
+        auto &cqe = static_cast<io_uring_cqe *>(cqes_)[head & cq_mask_];
+        auto operation = reinterpret_cast<Operation *>(cqe.user_data);
+        operation->result_ = cqe.res;
+        auto iter = tickets_.find(operation);
+        --pending_[iter->second];
+        tickets_.erase(iter);
+        --in_flight_;
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    return true;
+}
+}  // namespace naivedb::io
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "common/macros.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <sys/uio.h>
+#include <unordered_map>
+
+namespace naivedb::io {
+/**
+ * @brief IoUring is a thread-safe wrapper of a Linux io_uring instance, used through the raw system calls so that no
+ * library is needed.
+ *
+ * Threads submit batches of reads and writes and get a ticket for each batch. Any thread waiting for a ticket, or for
+ * room in the ring, reaps the completions of all the batches, so the ring needs no dedicated completion thread.
+ */
+class IoUring {
+    DISALLOW_COPY_AND_MOVE(IoUring)
+
+  public:
+    using ticket_t = uint64_t;
+
+    /**
+     * @brief A read or write of a contiguous range of a file, into or from one buffer, or several if iovecs_ is set.
+     *
+     */
+    struct Operation {
+        bool write_;
+        int fd_;
+        char *data_;
+        size_t size_;
+        size_t offset_;
+        // the number of bytes transferred, or -errno, set when the operation completes
+        int64_t result_;
+        // the buffers of a vectored operation, which replace data_ and size_
+        const iovec *iovecs_ = nullptr;
+        size_t iovcnt_ = 0;
+    };
+
+    /**
+     * @brief Create an io_uring instance.
+     *
+     * @param entries the maximum number of operations in flight
+     * @return std::unique_ptr<IoUring> the instance, or nullptr if the kernel does not support io_uring or its read and
+     * write operations
+     */
+    static std::unique_ptr<IoUring> create(unsigned entries);
+
+    ~IoUring();
+
+    /**
+     * @brief Submit a batch of operations. If the ring is full, this waits for earlier operations to complete.
+     *
+     * @param operations must stay alive until wait() returns for the ticket
+     * @param count
+     * @return ticket_t
+     */
+    ticket_t submit(Operation *operations, size_t count);
+
+    /**
+     * @brief Wait until all the operations of a batch complete. Each ticket must be waited for exactly once.
+     *
+     * @param ticket
+     */
+    void wait(ticket_t ticket);
+
+  private:
+    explicit IoUring(int ring_fd) : ring_fd_(ring_fd) {}
+
+    bool map_rings(unsigned sq_entries, unsigned cq_entries, const void *params);
+    void flush_submissions();
+
+    /**
+     * @brief Process the available completions, or block until there are some. Only one thread blocks in the kernel at
+     * a time, and the others wait for it to process the completions.
+     *
+     * @param latch the held latch_
+     */
+    void reap(std::unique_lock<std::mutex> &latch);
+
+    bool reap_available();
+
+    int ring_fd_;
+
+    // the mapped rings
+    void *sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    void *cq_ring_ = nullptr;
+    size_t cq_ring_size_ = 0;
+    void *sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned *sq_head_ = nullptr;
+    unsigned *sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned *sq_array_ = nullptr;
+    unsigned sq_entries_ = 0;
+    unsigned *cq_head_ = nullptr;
+    unsigned *cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    void *cqes_ = nullptr;
+
+    std::mutex latch_;
+    std::condition_variable cv_;
+    bool reaping_ = false;
+    // the number of operations queued but not passed to the kernel yet, and the number not completed yet
+    unsigned unsubmitted_ = 0;
+    unsigned in_flight_ = 0;
+    ticket_t next_ticket_ = 0;
+    // the number of operations not completed yet in each batch
+    std::unordered_map<ticket_t, size_t> pending_;
+    std::unordered_map<const Operation *, ticket_t> tickets_;
+};
+}  // namespace naivedb::io
@@ -0,0 +1,133 @@
+#include "io/memory_storage.h"
+
+#include "common/exception.h"
+#include "common/format.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <thread>
+
+namespace naivedb::io {
+MemoryStorage::MemoryStorage(const MemoryStorageOptions &options) : options_(options), next_ticket_(0) {}
+
+page_id_t MemoryStorage::alloc_page() {
+    std::unique_lock latch(latch_);
+    page_id_t page_id;
+    if (!free_page_ids_.empty()) {
+        page_id = *free_page_ids_.begin();
+        free_page_ids_.erase(free_page_ids_.begin());
+    } else {
+        page_id = pages_.size();
+        pages_.emplace_back();
+    }
+    // the page is zeroed by value-initialization
+    pages_[page_id] = std::make_unique<Page>();
+    return page_id;
+}
+
+void MemoryStorage::free_page(page_id_t page_id) {
+    std::unique_lock latch(latch_);
+    if (page_id < 0 || static_cast<size_t>(page_id) >= pages_.size() || !pages_[page_id]) {
+        throw IOException(fmt::format("cannot free unallocated page (page_id = {})", page_id));
+    }
+    pages_[page_id].reset();
+    free_page_ids_.insert(page_id);
+}
+
+void MemoryStorage::read_page(page_id_t page_id, char *page_data) {
+    {
+        std::shared_lock latch(latch_);
+        std::memcpy(page_data, page(page_id), PAGE_SIZE);
+    }
+    transfer(1);
+}
+
+void MemoryStorage::write_page(page_id_t page_id, const char *page_data) {
+    {
+        std::shared_lock latch(latch_);
+        std::memcpy(page(page_id), page_data, PAGE_SIZE);
+    }
+    transfer(1);
+}
+
+void MemoryStorage::read_pages(const std::vector<page_id_t> &page_ids, const std::vector<char *> &pages_data) {
+    assert(page_ids.size() == pages_data.size());
+    {
+        std::shared_lock latch(latch_);
+        for (size_t i = 0; i < page_ids.size(); ++i) {
+            std::memcpy(pages_data[i], page(page_ids[i]), PAGE_SIZE);
+        }
+    }
+    transfer(page_ids.size());
+}
+
+void MemoryStorage::write_pages(const std::vector<page_id_t> &page_ids, const std::vector<const char *> &pages_data) {
+    assert(page_ids.size() == pages_data.size());
+    {
+        std::shared_lock latch(latch_);
+        for (size_t i = 0; i < page_ids.size(); ++i) {
+            std::memcpy(page(page_ids[i]), pages_data[i], PAGE_SIZE);
+        }
+    }
+    transfer(page_ids.size());
+}
+
+MemoryStorage::io_ticket_t MemoryStorage::submit(IoRequest *requests, size_t count) {
+    {
+        std::shared_lock latch(latch_);
+        for (size_t i = 0; i < count; ++i) {
+            auto &request = requests[i];
+            try {
+                if (request.write_) {
+                    std::memcpy(page(request.page_id_), request.data_, PAGE_SIZE);
+                } else {
+                    std::memcpy(request.data_, page(request.page_id_), PAGE_SIZE);
+                }
+                request.succeeded_ = true;
+            } catch (const IOException &) {
+                request.succeeded_ = false;
+            }
+        }
+    }
+    transfer(count);
+    return next_ticket_.fetch_add(1);
+}
+
+page_id_t MemoryStorage::lowest_free_page_id() {
+    std::shared_lock latch(latch_);
+    return free_page_ids_.empty() ? static_cast<page_id_t>(pages_.size()) : *free_page_ids_.begin();
+}
+
+bool MemoryStorage::page_allocated(page_id_t page_id) {
+    std::shared_lock latch(latch_);
+    return page_id >= 0 && static_cast<size_t>(page_id) < pages_.size() && pages_[page_id];
+}
+
+size_t MemoryStorage::allocated_pages() {
+    std::shared_lock latch(latch_);
+    return pages_.size() - free_page_ids_.size();
+}
+
+char *MemoryStorage::page(page_id_t page_id) {
+    if (page_id < 0 || static_cast<size_t>(page_id) >= pages_.size() || !pages_[page_id]) {
+        throw IOException(fmt::format("I/O error accessing unallocated page (page_id = {})", page_id));
+    }
+    return pages_[page_id]->data_;
+}
+
+void MemoryStorage::transfer(size_t count) {
+    if (options_.latency_.count() == 0 && options_.bandwidth_ == 0) {
+        return;
+    }
+    auto done = std::chrono::steady_clock::now();
+    if (options_.bandwidth_ > 0) {
+        // the transfers of all the threads take turns on the device
+        std::chrono::nanoseconds duration(count * PAGE_SIZE * 1'000'000'000 / options_.bandwidth_);
+        std::scoped_lock latch(device_latch_);
+        busy_until_ = std::max(busy_until_, done) + duration;
+        done = busy_until_;
+    }
+    std::this_thread::sleep_until(done + options_.latency_);
+}
+}  // namespace naivedb::io
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "common/constants.h"
+#include "common/macros.h"
+#include "common/types.h"
+#include "io/storage.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <vector>
+
+namespace naivedb::io {
+/**
+ * @brief The options of MemoryStorage, which can make it behave like a slower device.
+ *
+ */
+struct MemoryStorageOptions {
+    // the time each read or write takes on top of its transfer time. A batch takes it only once.
+    std::chrono::nanoseconds latency_ = std::chrono::nanoseconds(0);
+    // the maximum number of bytes transferred per second, shared by all the threads, or 0 for no limit
+    size_t bandwidth_ = 0;
+};
+
+/**
+ * @brief MemoryStorage keeps the pages in memory. Nothing is durable, so it suits benchmarks that should measure the
+ * CPU cost of the layers above the storage, and temporary data that does not outlive the process.
+ *
+ * Pages are allocated lowest id first, as with DiskManager. The memory of a page is released when it is freed, and
+ * reading or writing a page that is not allocated is an error.
+ */
+class MemoryStorage : public Storage {
+    DISALLOW_COPY_AND_MOVE(MemoryStorage)
+
+  public:
+    explicit MemoryStorage(const MemoryStorageOptions &options = {});
+
+    page_id_t alloc_page() override;
+
+    void free_page(page_id_t page_id) override;
+
+    page_id_t lowest_free_page_id() override;
+
+    /**
+     * @brief The memory of the pages is released when they are freed, so there is nothing to truncate.
+     *
+     * @return size_t 0
+     */
+    size_t truncate_free_tail() override { return 0; }
+
+    void read_page(page_id_t page_id, char *page_data) override;
+
+    void write_page(page_id_t page_id, const char *page_data) override;
+
+    void read_page_aligned(page_id_t page_id, char *page_data) override { read_page(page_id, page_data); }
+
+    void write_page_aligned(page_id_t page_id, const char *page_data) override { write_page(page_id, page_data); }
+
+    void read_pages(const std::vector<page_id_t> &page_ids, const std::vector<char *> &pages_data) override;
+
+    void write_pages(const std::vector<page_id_t> &page_ids, const std::vector<const char *> &pages_data) override;
+
+    /**
+     * @brief Perform a batch of page reads and writes right away, as a single transfer.
+     *
+     * @param requests
+     * @param count
+     * @return io_ticket_t
+     */
+    io_ticket_t submit(IoRequest *requests, size_t count) override;
+
+    void wait(io_ticket_t) override {}
+
+    bool page_allocated(page_id_t page_id) override;
+
+    /**
+     * @brief Get the number of pages allocated.
+     *
+     * @return size_t
+     */
+    size_t allocated_pages();
+
+  private:
+    struct alignas(PAGE_SIZE) Page {
+        char data_[PAGE_SIZE];
+    };
+
+    /**
+     * @brief Get the memory of an allocated page. The latch must be held.
+     *
+     * @param page_id
+     * @return char*
+     */
+    char *page(page_id_t page_id);
+
+    /**
+     * @brief Wait for the time the device would take to transfer a number of pages, according to the options.
+     *
+     * @param count
+     */
+    void transfer(size_t count);
+
+    MemoryStorageOptions options_;
+
+    // protects the page slots, not the contents of the pages, which are protected by the buffer manager
+    std::shared_mutex latch_;
+    // the pages by their ids, with nullptr for free pages
+    std::vector<std::unique_ptr<Page>> pages_;
+    std::set<page_id_t> free_page_ids_;
+
+    // the time the simulated device has finished the transfers started so far
+    std::mutex device_latch_;
+    std::chrono::steady_clock::time_point busy_until_;
+
+    std::atomic<io_ticket_t> next_ticket_;
+};
+}  // namespace naivedb::io
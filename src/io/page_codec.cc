@@ -0,0 +1,162 @@
+#include "io/page_codec.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+namespace naivedb::io {
+namespace {
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_DISTANCE = 65535;
+constexpr unsigned HASH_BITS = 12;
+
+uint32_t load32(const char *p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t hash(uint32_t value) { return (value * 2654435761u) >> (32 - HASH_BITS); }
+
+/**
+ * @brief Write a length that does not fit in its 4 bits of the token, as a run of 255s and a final byte below 255.
+ *
+ */
+bool write_length(size_t length, char *&op, const char *end) {
+    for (length -= 15; length >= 255; length -= 255) {
+        if (op == end) {
+            return false;
+        }
+        *op++ = static_cast<char>(255);
+    }
+    if (op == end) {
+        return false;
+    }
+    *op++ = static_cast<char>(length);
+    return true;
+}
+
+bool read_length(size_t &length, const unsigned char *&ip, const unsigned char *end) {
+    unsigned char byte;
+    do {
+        if (ip == end) {
+            return false;
+        }
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+/**
+ * @brief Write a pair of literals and match. A match length of 0 marks the last pair, which has no match.
+ *
+ */
+bool write_sequence(
+    const char *literals, size_t literal_length, size_t distance, size_t match_length, char *&op, const char *end) {
+    if (op == end) {
+        return false;
+    }
+    auto &token = *op++;
+    token = static_cast<char>(std::min<size_t>(literal_length, 15) << 4);
+    if (literal_length >= 15 && !write_length(literal_length, op, end)) {
+        return false;
+    }
+    if (static_cast<size_t>(end - op) < literal_length) {
+        return false;
+    }
+    std::memcpy(op, literals, literal_length);
+    op += literal_length;
+    if (match_length == 0) {
+        return true;
+    }
+    if (end - op < 2) {
+        return false;
+    }
+    *op++ = static_cast<char>(distance & 0xff);
+    *op++ = static_cast<char>(distance >> 8);
+    auto length = match_length - MIN_MATCH;
+    token = static_cast<char>(token | std::min<size_t>(length, 15));
+    return length < 15 || write_length(length, op, end);
+}
+}  // namespace
+
+size_t compress_block(const char *src, size_t size, char *dst, size_t capacity) {
+    assert(size <= MAX_DISTANCE);
+    // the positions of the last 4-byte sequences with each hash, plus 1 so that 0 means none
+    uint16_t table[1 << HASH_BITS] = {};
+    char *op = dst;
+    const char *end = dst + capacity;
+    size_t anchor = 0, i = 0;
+    while (i + MIN_MATCH <= size) {
+        auto value = load32(src + i);
+        auto &entry = table[hash(value)];
+        size_t candidate = entry;
+        entry = static_cast<uint16_t>(i + 1);
+        if (candidate == 0 || load32(src + candidate - 1) != value) {
+            ++i;
+            continue;
+        }
+        --candidate;
+        size_t length = MIN_MATCH;
+        while (i + length < size && src[candidate + length] == src[i + length]) {
+            ++length;
+        }
+        if (!write_sequence(src + anchor, i - anchor, i - candidate, length, op, end)) {
+            return 0;
+        }
+        i += length;
+        anchor = i;
+    }
+    if (!write_sequence(src + anchor, size - anchor, 0, 0, op, end)) {
+        return 0;
+    }
+    return op - dst;
+}
+
+bool decompress_block(const char *src, size_t size, char *dst, size_t dst_size) {
+    auto ip = reinterpret_cast<const unsigned char *>(src);
+    auto end = ip + size;
+    size_t written = 0;
+    while (true) {
+        // the block must end with a pair without a match
+        if (ip == end) {
+            return false;
+        }
+        auto token = *ip++;
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !read_length(literal_length, ip, end)) {
+            return false;
+        }
+        if (static_cast<size_t>(end - ip) < literal_length || dst_size - written < literal_length) {
+            return false;
+        }
+        std::memcpy(dst + written, ip, literal_length);
+        ip += literal_length;
+        written += literal_length;
+        if (ip == end) {
+            // the last pair
+            break;
+        }
+        if (end - ip < 2) {
+            return false;
+        }
+        size_t distance = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t match_length = token & 0xf;
+        if (match_length == 15 && !read_length(match_length, ip, end)) {
+            return false;
+        }
+        match_length += MIN_MATCH;
+        if (distance == 0 || distance > written || dst_size - written < match_length) {
+            return false;
+        }
+        // the match may overlap the bytes it produces, so it is copied byte by byte
+        for (size_t k = 0; k < match_length; ++k, ++written) {
+            dst[written] = dst[written - distance];
+        }
+    }
+    return written == dst_size;
+}
+}  // namespace naivedb::io
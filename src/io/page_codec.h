@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+
+namespace naivedb::io {
+/**
+ * @brief Compress a block of at most 64K bytes with a byte-oriented LZ77 codec in the style of LZ4. It is fast rather
+ * than tight, and mostly removes the zero padding and the repeated values of table pages.
+ *
+ * The output is a sequence of (literals, match) pairs. Each starts with a token byte holding the number of literals in
+ * its high 4 bits and the length of the match minus 4 in its low 4 bits, either of which is continued in the following
+ * bytes if it is 15. The literals follow, then the distance of the match as 2 little-endian bytes. The last pair has
+ * literals only.
+ *
+ * @param src
+ * @param size
+ * @param dst
+ * @param capacity the size of dst
+ * @return size_t the size of the compressed block, or 0 if it would not fit in capacity
+ */
+size_t compress_block(const char *src, size_t size, char *dst, size_t capacity);
+
+/**
+ * @brief Decompress a block compressed by compress_block(). The input is validated, so a corrupted block is reported
+ * rather than read or written out of bounds.
+ *
+ * @param src
+ * @param size the size of the compressed block
+ * @param dst
+ * @param dst_size the size of the decompressed block
+ * @return true
+ * @return false if the block is corrupted or does not decompress to exactly dst_size bytes
+ */
+bool decompress_block(const char *src, size_t size, char *dst, size_t dst_size);
+}  // namespace naivedb::io
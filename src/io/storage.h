@@ -0,0 +1,139 @@
+#pragma once
+
+#include "common/types.h"
+
+#include <cstdint>
+#include <stddef.h>
+#include <vector>
+
+namespace naivedb::io {
+/**
+ * @brief Storage is the interface of the page stores the buffer manager reads pages from and writes pages to.
+ *
+ * DiskManager stores the pages in a file and Tablespace stripes them over several files. MemoryStorage keeps them in
+ * memory, which is not durable, for benchmarks that should not pay for real I/O and for temporary data.
+ *
+ * All the operations are thread-safe. Pages read as zeros after they are allocated.
+ */
+class Storage {
+  public:
+    /**
+     * @brief A page read or write submitted with submit().
+     *
+     */
+    struct IoRequest {
+        page_id_t page_id_;
+        // must be aligned to PAGE_SIZE
+        char *data_;
+        bool write_;
+        // set by wait(): true if the page has been transferred
+        bool succeeded_;
+    };
+
+    using io_ticket_t = uint64_t;
+
+    virtual ~Storage() = default;
+
+    /**
+     * @brief Allocate a new page
+     *
+     * @return page_id_t
+     */
+    virtual page_id_t alloc_page() = 0;
+
+    /**
+     * @brief Deallocate a page
+     *
+     * @param page_id
+     */
+    virtual void free_page(page_id_t page_id) = 0;
+
+    /**
+     * @brief Get the lowest page id that is not allocated, without allocating it.
+     *
+     * @return page_id_t the page id, or INVALID_PAGE_ID if no page can be allocated
+     */
+    virtual page_id_t lowest_free_page_id() = 0;
+
+    /**
+     * @brief Release the space after the last allocated page.
+     *
+     * @return size_t the number of bytes released
+     */
+    virtual size_t truncate_free_tail() = 0;
+
+    /**
+     * @brief Read data from a page
+     *
+     * @param page_id
+     * @param page_data
+     */
+    virtual void read_page(page_id_t page_id, char *page_data) = 0;
+
+    /**
+     * @brief Write data to a page
+     *
+     * @param page_id
+     * @param page_data
+     */
+    virtual void write_page(page_id_t page_id, const char *page_data) = 0;
+
+    /**
+     * @brief Read data from a page straight into the given memory, without copying it through an aligned buffer
+     *
+     * @param page_id
+     * @param page_data must be aligned to PAGE_SIZE
+     */
+    virtual void read_page_aligned(page_id_t page_id, char *page_data) = 0;
+
+    /**
+     * @brief Write data to a page straight from the given memory, without copying it through an aligned buffer
+     *
+     * @param page_id
+     * @param page_data must be aligned to PAGE_SIZE
+     */
+    virtual void write_page_aligned(page_id_t page_id, const char *page_data) = 0;
+
+    /**
+     * @brief Read a batch of pages, which is cheaper than reading them one by one.
+     *
+     * @param page_ids
+     * @param pages_data the memory to read each page into, which must be aligned to PAGE_SIZE
+     */
+    virtual void read_pages(const std::vector<page_id_t> &page_ids, const std::vector<char *> &pages_data) = 0;
+
+    /**
+     * @brief Write a batch of pages, which is cheaper than writing them one by one.
+     *
+     * @param page_ids
+     * @param pages_data the memory to write each page from, which must be aligned to PAGE_SIZE
+     */
+    virtual void write_pages(const std::vector<page_id_t> &page_ids, const std::vector<const char *> &pages_data) = 0;
+
+    /**
+     * @brief Start a batch of page reads and writes, which may be performed in any order.
+     *
+     * @param requests must stay alive until wait() returns for the ticket
+     * @param count
+     * @return io_ticket_t
+     */
+    virtual io_ticket_t submit(IoRequest *requests, size_t count) = 0;
+
+    /**
+     * @brief Wait for a batch started by submit() and set the succeeded_ flags of its requests. Each ticket must be
+     * waited for exactly once.
+     *
+     * @param ticket
+     */
+    virtual void wait(io_ticket_t ticket) = 0;
+
+    /**
+     * @brief Check whether the given page is allocated
+     *
+     * @param page_id
+     * @return true
+     * @return false
+     */
+    virtual bool page_allocated(page_id_t page_id) = 0;
+};
+}  // namespace naivedb::io
@@ -0,0 +1,157 @@
+#include "io/tablespace.h"
+
+#include "common/exception.h"
+#include "common/format.h"
+
+#include <cassert>
+
+namespace naivedb::io {
+Tablespace::Tablespace(const std::vector<std::string> &file_names, IoBackend backend)
+    : next_file_(0), next_ticket_(0) {
+    assert(!file_names.empty());
+    for (const auto &file_name : file_names) {
+        files_.emplace_back(std::make_unique<DiskManager>(file_name, backend));
+    }
+}
+
+page_id_t Tablespace::alloc_page() {
+    size_t first = next_file_.fetch_add(1) % files_.size();
+    for (size_t i = 0; i < files_.size(); ++i) {
+        size_t index = (first + i) % files_.size();
+        try {
+            return files_[index]->alloc_page() * files_.size() + index;
+        } catch (const IOException &) {
+            // the file is full, or its device has failed
+            if (i + 1 == files_.size()) {
+                throw;
+            }
+        }
+    }
+    UNREACHABLE;
+}
+
+void Tablespace::free_page(page_id_t page_id) { files_[file_index(page_id)]->free_page(file_page_id(page_id)); }
+
+size_t Tablespace::truncate_free_tail() {
+    size_t released = 0;
+    for (auto &file : files_) {
+        released += file->truncate_free_tail();
+    }
+    return released;
+}
+
+void Tablespace::read_page(page_id_t page_id, char *page_data) {
+    files_[file_index(page_id)]->read_page(file_page_id(page_id), page_data);
+}
+
+void Tablespace::write_page(page_id_t page_id, const char *page_data) {
+    files_[file_index(page_id)]->write_page(file_page_id(page_id), page_data);
+}
+
+void Tablespace::read_page_aligned(page_id_t page_id, char *page_data) {
+    files_[file_index(page_id)]->read_page_aligned(file_page_id(page_id), page_data);
+}
+
+void Tablespace::write_page_aligned(page_id_t page_id, const char *page_data) {
+    files_[file_index(page_id)]->write_page_aligned(file_page_id(page_id), page_data);
+}
+
+void Tablespace::read_pages(const std::vector<page_id_t> &page_ids, const std::vector<char *> &pages_data) {
+    assert(page_ids.size() == pages_data.size());
+    std::vector<std::vector<page_id_t>> file_page_ids(files_.size());
+    std::vector<std::vector<char *>> file_pages_data(files_.size());
+    for (size_t i = 0; i < page_ids.size(); ++i) {
+        file_page_ids[file_index(page_ids[i])].emplace_back(file_page_id(page_ids[i]));
+        file_pages_data[file_index(page_ids[i])].emplace_back(pages_data[i]);
+    }
+    for (size_t i = 0; i < files_.size(); ++i) {
+        if (!file_page_ids[i].empty()) {
+            files_[i]->read_pages(file_page_ids[i], file_pages_data[i]);
+        }
+    }
+}
+
+void Tablespace::write_pages(const std::vector<page_id_t> &page_ids, const std::vector<const char *> &pages_data) {
+    assert(page_ids.size() == pages_data.size());
+    std::vector<std::vector<page_id_t>> file_page_ids(files_.size());
+    std::vector<std::vector<const char *>> file_pages_data(files_.size());
+    for (size_t i = 0; i < page_ids.size(); ++i) {
+        file_page_ids[file_index(page_ids[i])].emplace_back(file_page_id(page_ids[i]));
+        file_pages_data[file_index(page_ids[i])].emplace_back(pages_data[i]);
+    }
+    for (size_t i = 0; i < files_.size(); ++i) {
+        if (!file_page_ids[i].empty()) {
+            files_[i]->write_pages(file_page_ids[i], file_pages_data[i]);
+        }
+    }
+}
+
+Tablespace::io_ticket_t Tablespace::submit(IoRequest *requests, size_t count) {
+    IoBatch batch;
+    batch.requests_ = requests;
+    // group the requests by file, so that the part of each file is contiguous
+    std::vector<size_t> file_counts(files_.size() + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        ++file_counts[file_index(requests[i].page_id_) + 1];
+    }
+    for (size_t i = 1; i <= files_.size(); ++i) {
+        file_counts[i] += file_counts[i - 1];
+    }
+    batch.indexes_.resize(count);
+    batch.file_requests_.resize(count);
+    auto next = file_counts;
+    for (size_t i = 0; i < count; ++i) {
+        auto position = next[file_index(requests[i].page_id_)]++;
+        batch.indexes_[position] = i;
+        batch.file_requests_[position] = requests[i];
+        batch.file_requests_[position].page_id_ = file_page_id(requests[i].page_id_);
+    }
+    for (size_t i = 0; i < files_.size(); ++i) {
+        if (file_counts[i + 1] > file_counts[i]) {
+            auto ticket =
+                files_[i]->submit(batch.file_requests_.data() + file_counts[i], file_counts[i + 1] - file_counts[i]);
+            batch.tickets_.emplace_back(i, ticket);
+        }
+    }
+
+    std::scoped_lock latch(batches_latch_);
+    auto ticket = next_ticket_++;
+    batches_.emplace(ticket, std::move(batch));
+    return ticket;
+}
+
+void Tablespace::wait(io_ticket_t ticket) {
+    IoBatch batch;
+    {
+        std::scoped_lock latch(batches_latch_);
+        auto iter = batches_.find(ticket);
+        batch = std::move(iter->second);
+        batches_.erase(iter);
+    }
+    for (auto [file_index, file_ticket] : batch.tickets_) {
+        files_[file_index]->wait(file_ticket);
+    }
+    for (size_t i = 0; i < batch.file_requests_.size(); ++i) {
+        batch.requests_[batch.indexes_[i]].succeeded_ = batch.file_requests_[i].succeeded_;
+    }
+}
+
+page_id_t Tablespace::lowest_free_page_id() {
+    auto lowest = INVALID_PAGE_ID;
+    for (size_t index = 0; index < files_.size(); ++index) {
+        auto file_page_id = files_[index]->lowest_free_page_id();
+        if (file_page_id == INVALID_PAGE_ID) {
+            continue;
+        }
+        page_id_t page_id = file_page_id * files_.size() + index;
+        if (lowest == INVALID_PAGE_ID || page_id < lowest) {
+            lowest = page_id;
+        }
+    }
+    return lowest;
+}
+
+bool Tablespace::page_allocated(page_id_t page_id) {
+    return files_[file_index(page_id)]->page_allocated(file_page_id(page_id));
+}
+}  // namespace naivedb::io
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "common/macros.h"
+#include "common/types.h"
+#include "io/disk_manager.h"
+#include "io/storage.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace naivedb::io {
+/**
+ * @brief Tablespace stripes pages across several files, each managed by its own DiskManager with its own master and
+ * header pages. The files may be on different devices, so that the capacity and the I/O of the database are spread
+ * over them.
+ *
+ * Page i of the tablespace is page i / N of file i % N, where N is the number of files. Allocations take turns among
+ * the files, so consecutive pages land in different files, and a file that is full is skipped. The files must always
+ * be opened in the same order.
+ *
+ * Tablespace offers the page API of DiskManager and is safe to use from several threads.
+ */
+class Tablespace : public Storage {
+    DISALLOW_COPY_AND_MOVE(Tablespace)
+
+  public:
+    /**
+     * @brief Open or create the files of a tablespace.
+     *
+     * @param file_names at least one file
+     * @param backend
+     */
+    explicit Tablespace(const std::vector<std::string> &file_names, IoBackend backend = IoBackend::Sync);
+
+    size_t num_files() const { return files_.size(); }
+
+    page_id_t alloc_page() override;
+
+    void free_page(page_id_t page_id) override;
+
+    /**
+     * @brief Get the lowest page id that is not allocated in any of the files. The pages are allocated in the files in
+     * turn, so alloc_page() may not return it.
+     *
+     * @return page_id_t
+     */
+    page_id_t lowest_free_page_id() override;
+
+    /**
+     * @brief Truncate each file after its last allocated page.
+     *
+     * @return size_t the number of bytes the files have shrunk by in total
+     */
+    size_t truncate_free_tail() override;
+
+    void read_page(page_id_t page_id, char *page_data) override;
+
+    void write_page(page_id_t page_id, const char *page_data) override;
+
+    void read_page_aligned(page_id_t page_id, char *page_data) override;
+
+    void write_page_aligned(page_id_t page_id, const char *page_data) override;
+
+    /**
+     * @brief Read a batch of pages. The batch is split by file, and each file reads its part as in
+     * DiskManager::read_pages().
+     *
+     * @param page_ids
+     * @param pages_data
+     */
+    void read_pages(const std::vector<page_id_t> &page_ids, const std::vector<char *> &pages_data) override;
+
+    void write_pages(const std::vector<page_id_t> &page_ids, const std::vector<const char *> &pages_data) override;
+
+    /**
+     * @brief Start a batch of page reads and writes, split into one batch per file, so that all the files work on it
+     * at the same time.
+     *
+     * @param requests must stay alive until wait() returns for the ticket
+     * @param count
+     * @return io_ticket_t
+     */
+    io_ticket_t submit(IoRequest *requests, size_t count) override;
+
+    void wait(io_ticket_t ticket) override;
+
+    /**
+     * @brief Get the backend in use, which is Sync if IoUring was requested but is not supported.
+     *
+     * @return IoBackend
+     */
+    IoBackend backend() const { return files_.front()->backend(); }
+
+    bool page_allocated(page_id_t page_id) override;
+
+  private:
+    /**
+     * @brief The batches a batch of submit() has been split into.
+     *
+     */
+    struct IoBatch {
+        IoRequest *requests_;
+        // the index of each request of the file batches in requests_
+        std::vector<size_t> indexes_;
+        std::vector<IoRequest> file_requests_;
+        std::vector<std::pair<size_t, io_ticket_t>> tickets_;
+    };
+
+    size_t file_index(page_id_t page_id) const { return page_id % files_.size(); }
+    page_id_t file_page_id(page_id_t page_id) const { return page_id / files_.size(); }
+
+    std::vector<std::unique_ptr<DiskManager>> files_;
+    // the file the next allocation tries first
+    std::atomic<size_t> next_file_;
+
+    std::mutex batches_latch_;
+    io_ticket_t next_ticket_;
+    std::unordered_map<io_ticket_t, IoBatch> batches_;
+};
+}  // namespace naivedb::io
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "buffer/buffer_access_strategy.h"
 #include "catalog/schema.h"
 #include "query/execution/executor/executor.h"
 #include "query/execution/executor_context.h"
@@ -23,6 +24,8 @@ class SeqScanExecutor : public Executor {
     const PhysicalSeqScan *plan_;
     std::unique_ptr<storage::TableHeap> table_heap_;
     storage::TableHeap::Iterator table_iter_;
+    // pass it to TableHeap::begin(), so that scanning a large table does not flush the buffer pool
+    buffer::BufferAccessStrategy scan_strategy_;
     // TODO(Project-1): Add more members if you need
 };
 }  // namespace naivedb::query
\ No newline at end of file
@@ -1,78 +1,115 @@
 #pragma once
 
+#include "buffer/buffer_manager.h"
+#include "buffer/optimistic_latch.h"
 #include "common/constants.h"
 #include "common/macros.h"
 #include "common/types.h"
 
 #include <cstring>
-#include <functional>
-#include <shared_mutex>
 
 namespace naivedb::storage {
 /**
  * @brief PageGuard is a wrapper of a raw page in memory. With RAII technique, the page can be unpinned automatically
  * when going out of scope.
  *
+ * The guard refers to its frame directly, so creating, moving and destroying it never allocates memory.
  */
 class PageGuard {
     DISALLOW_COPY(PageGuard)
 
   public:
     PageGuard()
-        : data_(nullptr), page_id_(INVALID_PAGE_ID), dirty_(false), rwlatch_(nullptr), unpin_callback_(NOP_CALLBACK) {}
+        : data_(nullptr)
+        , page_id_(INVALID_PAGE_ID)
+        , dirty_(false)
+        , rwlatch_(nullptr)
+        , buffer_manager_(nullptr)
+        , frame_id_(INVALID_FRAME_ID) {}
 
-    PageGuard(char *data, page_id_t page_id, std::shared_mutex *rwlatch, std::function<void(bool)> &&unpin_callback)
+    /**
+     * @brief Construct a new PageGuard object for a pinned frame.
+     *
+     * @param data
+     * @param page_id
+     * @param rwlatch
+     * @param buffer_manager the buffer manager to unpin the frame with when the guard is destroyed
+     * @param frame_id
+     */
+    PageGuard(char *data,
+              page_id_t page_id,
+              buffer::OptimisticLatch *rwlatch,
+              buffer::BufferManager *buffer_manager,
+              frame_id_t frame_id)
         : data_(data)
         , page_id_(page_id)
         , dirty_(false)
         , rwlatch_(rwlatch)
-        , unpin_callback_(std::move(unpin_callback)) {}
+        , buffer_manager_(buffer_manager)
+        , frame_id_(frame_id) {}
 
     PageGuard(PageGuard &&page_guard)
         : data_(page_guard.data_)
         , page_id_(page_guard.page_id_)
         , dirty_(page_guard.dirty_)
         , rwlatch_(page_guard.rwlatch_)
-        , unpin_callback_(std::move(page_guard.unpin_callback_)) {
-        page_guard.unpin_callback_ = NOP_CALLBACK;
+        , buffer_manager_(page_guard.buffer_manager_)
+        , frame_id_(page_guard.frame_id_) {
+        page_guard.buffer_manager_ = nullptr;
     }
 
     PageGuard &operator=(PageGuard &&page_guard) {
-        unpin_callback_(dirty_);
+        unpin();
         data_ = page_guard.data_;
         page_id_ = page_guard.page_id_;
         dirty_ = page_guard.dirty_;
         rwlatch_ = page_guard.rwlatch_;
-        unpin_callback_ = std::move(page_guard.unpin_callback_);
-        page_guard.unpin_callback_ = NOP_CALLBACK;
+        buffer_manager_ = page_guard.buffer_manager_;
+        frame_id_ = page_guard.frame_id_;
+        page_guard.buffer_manager_ = nullptr;
         return *this;
     }
 
-    ~PageGuard() { unpin_callback_(dirty_); }
+    ~PageGuard() { unpin(); }
 
     const char *data() const { return data_; }
 
     char *data_mut() {
-        dirty_ = true;
+        mark_dirty();
         return data_;
     }
 
     void clear() {
-        dirty_ = true;
+        mark_dirty();
         std::memset(data_, 0, PAGE_SIZE);
     }
 
     page_id_t page_id() const { return page_id_; }
 
-    std::shared_mutex &rwlatch() const { return *rwlatch_; }
+    buffer::OptimisticLatch &rwlatch() const { return *rwlatch_; }
 
   private:
+    void mark_dirty() {
+        // the frame is marked dirty at every modification rather than the first one, since a checkpoint may clean it
+        // while the guard is held, and a checkpoint started afterwards must write it again
+        if (buffer_manager_) {
+            buffer_manager_->mark_frame_dirty(frame_id_);
+        }
+        dirty_ = true;
+    }
+
+    void unpin() {
+        if (buffer_manager_) {
+            buffer_manager_->unpin_frame(frame_id_, dirty_);
+        }
+    }
+
     char *data_;
     page_id_t page_id_;
     bool dirty_;
-    std::shared_mutex *rwlatch_;
-    std::function<void(bool)> unpin_callback_;
-
-    static constexpr auto NOP_CALLBACK = [](bool) {};
+    buffer::OptimisticLatch *rwlatch_;
+    // null if the guard is empty or has been moved from
+    buffer::BufferManager *buffer_manager_;
+    frame_id_t frame_id_;
 };
 }  // namespace naivedb::storage
\ No newline at end of file
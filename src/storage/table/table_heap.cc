@@ -10,8 +10,11 @@
 #include "storage/tuple/tuple_id.h"
 #include "transaction/transaction.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <optional>
+#include <thread>
 
 namespace naivedb::storage {
 TableHeap::TableHeap(buffer::BufferManager *buffer_manager, log::LogManager *log_manager)
@@ -27,25 +30,28 @@ TableHeap::TableHeap(buffer::BufferManager *buffer_manager, log::LogManager *log
 TableHeap::TableHeap(buffer::BufferManager *buffer_manager, page_id_t root_page_id, log::LogManager *log_manager)
     : buffer_manager_(buffer_manager), root_page_id_(root_page_id), log_manager_(log_manager) {}
 
-// TODO(TA): use latch
 tuple_id_t TableHeap::insert_tuple(const Tuple &tuple) {
     auto root_page = buffer_manager_->fetch_page(root_page_id_);
     if (!root_page) {
         return INVALID_TUPLE_ID;
     }
     auto current_table_page = TablePage(*std::move(root_page));
+    auto latch = current_table_page.write_latch();
 
     slot_id_t slot_id;
     while ((slot_id = current_table_page.insert_tuple(tuple)) == INVALID_SLOT_ID) {
         auto next_page_id = current_table_page.next_page_id();
         // if the next page is a valid page
         if (next_page_id != INVALID_PAGE_ID) {
+            // unlatch the current page first, since backward iterators latch the pages in the opposite order
+            latch.unlock();
             // unpin the current page and try to insert the tuple in the next page
             auto next_page = buffer_manager_->fetch_page(next_page_id);
             if (!next_page) {
                 return INVALID_TUPLE_ID;
             }
             current_table_page = TablePage(*std::move(next_page));
+            latch = current_table_page.write_latch();
         }
         // otherwise create a new page and try to insert the tuple in it
         else {
@@ -54,15 +60,17 @@ tuple_id_t TableHeap::insert_tuple(const Tuple &tuple) {
                 return INVALID_TUPLE_ID;
             }
             auto new_table_page = TablePage(*std::move(new_page));
-            current_table_page.set_next_page_id(new_table_page.page_id());
+            // nobody else can reach the new page before it is linked, so latching it cannot deadlock
+            auto new_latch = new_table_page.write_latch();
             new_table_page.init(current_table_page.page_id());
+            current_table_page.set_next_page_id(new_table_page.page_id());
+            latch = std::move(new_latch);
             current_table_page = std::move(new_table_page);
         }
     }
     return TupleId(current_table_page.page_id(), slot_id).tuple_id();
 }
 
-// TODO(TA): use latch
 bool TableHeap::delete_tuple(tuple_id_t tuple_id) {
     auto [page_id, slot_id] = TupleId(tuple_id).page_id_and_slot_id();
     auto page = buffer_manager_->fetch_page(page_id);
@@ -73,6 +81,7 @@ bool TableHeap::delete_tuple(tuple_id_t tuple_id) {
     page_id_t prev_page_id, next_page_id;
     {
         auto table_page = TablePage(*std::move(page));
+        auto latch = table_page.write_latch();
         if (!table_page.delete_tuple(slot_id)) {
             return false;
         }
@@ -86,14 +95,18 @@ bool TableHeap::delete_tuple(tuple_id_t tuple_id) {
         if (!prev_page) {
             return false;
         }
-        auto prev_table_page = TablePage(*std::move(prev_page));
-        prev_table_page.set_next_page_id(next_page_id);
+        {
+            auto prev_table_page = TablePage(*std::move(prev_page));
+            auto latch = prev_table_page.write_latch();
+            prev_table_page.set_next_page_id(next_page_id);
+        }
         if (next_page_id != INVALID_PAGE_ID) {
             auto next_page = buffer_manager_->fetch_page(next_page_id);
             if (!next_page) {
                 return false;
             }
             auto next_table_page = TablePage(*std::move(next_page));
+            auto latch = next_table_page.write_latch();
             next_table_page.set_prev_page_id(prev_page_id);
         }
         if (!buffer_manager_->delete_page(page_id)) {
@@ -103,15 +116,14 @@ bool TableHeap::delete_tuple(tuple_id_t tuple_id) {
     return true;
 }
 
-std::optional<Tuple> TableHeap::get_tuple(tuple_id_t tuple_id) {
+std::optional<Tuple> TableHeap::get_tuple(tuple_id_t tuple_id, buffer::BufferAccessStrategy *strategy) {
     auto [page_id, slot_id] = TupleId(tuple_id).page_id_and_slot_id();
-    auto page = buffer_manager_->fetch_page(page_id);
+    auto page = buffer_manager_->fetch_page(page_id, strategy);
     if (!page) {
         return std::nullopt;
     }
     auto table_page = TablePage(*std::move(page));
-    auto latch = table_page.read_latch();
-    return table_page.get_tuple(slot_id);
+    return table_page.read([slot_id = slot_id](const TablePage &page) { return page.get_tuple(slot_id); });
 }
 
 bool TableHeap::update_tuple(tuple_id_t tuple_id, const Tuple &tuple, transaction::Transaction *txn) {
@@ -137,56 +149,202 @@ bool TableHeap::update_tuple(tuple_id_t tuple_id, const Tuple &tuple, transactio
     return table_page.update_tuple(slot_id, tuple);
 }
 
-TableHeap::Iterator TableHeap::begin() {
-    auto page = buffer_manager_->fetch_page(root_page_id_);
+TableHeap::Iterator TableHeap::begin(buffer::BufferAccessStrategy *strategy) {
+    auto page = buffer_manager_->fetch_page(root_page_id_, strategy);
     assert(page);
 
     auto table_page = TablePage(*std::move(page));
-    auto latch = table_page.read_latch();
-    auto slot_id = table_page.first_slot();
     // if root page is empty, find the first slot in the next page
-    if (slot_id == INVALID_SLOT_ID) {
-        auto next_page_id = table_page.next_page_id();
-        if (next_page_id == INVALID_PAGE_ID) {
-            return Iterator(this, INVALID_TUPLE_ID);
-        }
-        auto next_page = buffer_manager_->fetch_page(next_page_id);
-        assert(next_page);
-        auto next_table_page = TablePage(*std::move(next_page));
-        auto next_latch = next_table_page.read_latch();
-        // except the root page, other pages must be non-empty
-        slot_id = next_table_page.first_slot();
-        return Iterator(this, TupleId(next_page_id, slot_id).tuple_id());
+    auto tuple_id = seek(table_page, INVALID_SLOT_ID, true, strategy);
+    auto iter = Iterator(this, tuple_id, strategy);
+    if (tuple_id != INVALID_TUPLE_ID) {
+        iter.read_ahead(TupleId(tuple_id).page_id());
     }
-    return Iterator(this, TupleId(root_page_id_, slot_id).tuple_id());
+    return iter;
 }
 
 TableHeap::Iterator TableHeap::end() { return Iterator(this, INVALID_TUPLE_ID); }
 
+bool TableHeap::compact(const CompactionOptions &options, CompactionProgress &progress) {
+    std::chrono::nanoseconds interval(0);
+    if (options.max_pages_per_second_ > 0) {
+        interval = std::chrono::nanoseconds(std::chrono::seconds(1)) / options.max_pages_per_second_;
+    }
+    auto next_move_time = std::chrono::steady_clock::now();
+
+    auto root_page = buffer_manager_->fetch_page(root_page_id_);
+    if (!root_page) {
+        return false;
+    }
+    auto page_id = TablePage(*std::move(root_page)).next_page_id();
+    while (page_id != INVALID_PAGE_ID) {
+        auto current_page_id = page_id;
+        {
+            auto page = buffer_manager_->fetch_page(current_page_id);
+            if (!page) {
+                return false;
+            }
+            page_id = TablePage(*std::move(page)).next_page_id();
+        }
+        ++progress.pages_visited_;
+        // a page is only allocated to move to if the storage has a free page with a lower id
+        auto free_page_id = buffer_manager_->lowest_free_page_id();
+        if (free_page_id != INVALID_PAGE_ID && free_page_id < current_page_id) {
+            auto new_page = buffer_manager_->new_page();
+            if (!new_page) {
+                return false;
+            }
+            auto new_page_id = new_page->page_id();
+            new_page.reset();
+            if (new_page_id > current_page_id) {
+                // the storage does not always allocate the lowest free id first, e.g. a tablespace
+                buffer_manager_->delete_page(new_page_id);
+            } else {
+                if (interval.count() > 0) {
+                    std::this_thread::sleep_until(next_move_time);
+                    next_move_time = std::max(next_move_time + interval, std::chrono::steady_clock::now());
+                }
+                if (!move_page(current_page_id, new_page_id)) {
+                    return false;
+                }
+                ++progress.pages_moved_;
+            }
+        }
+        if (options.on_progress_) {
+            options.on_progress_(progress);
+        }
+    }
+    return true;
+}
+
+bool TableHeap::drop() {
+    auto page_id = root_page_id_;
+    while (page_id != INVALID_PAGE_ID) {
+        auto page = buffer_manager_->fetch_page(page_id);
+        if (!page) {
+            return false;
+        }
+        auto next_page_id = TablePage(*std::move(page)).next_page_id();
+        std::optional<PageGuard> next_page;
+        if (next_page_id != INVALID_PAGE_ID) {
+            next_page = buffer_manager_->fetch_page(next_page_id);
+            if (!next_page) {
+                return false;
+            }
+        }
+        if (!buffer_manager_->delete_page(page_id)) {
+            return false;
+        }
+        // the pages left start after the freed one, in case the drop has to be retried
+        if (next_page) {
+            auto next_table_page = TablePage(*std::move(next_page));
+            auto latch = next_table_page.write_latch();
+            next_table_page.set_prev_page_id(INVALID_PAGE_ID);
+        }
+        page_id = root_page_id_ = next_page_id;
+    }
+    return true;
+}
+
+bool TableHeap::move_page(page_id_t page_id, page_id_t new_page_id) {
+    auto linked = [&]() {
+        auto page = buffer_manager_->fetch_page(page_id);
+        auto new_page = buffer_manager_->fetch_page(new_page_id);
+        if (!page || !new_page) {
+            return false;
+        }
+        auto table_page = TablePage(*std::move(page));
+        auto new_table_page = TablePage(*std::move(new_page));
+        page_id_t prev_page_id, next_page_id;
+        {
+            auto latch = table_page.read_latch();
+            prev_page_id = table_page.prev_page_id();
+            next_page_id = table_page.next_page_id();
+        }
+        // the neighbours are pinned before the first modification, so that a failure leaves the table as it was
+        auto prev_page = buffer_manager_->fetch_page(prev_page_id);
+        std::optional<PageGuard> next_page;
+        if (next_page_id != INVALID_PAGE_ID) {
+            next_page = buffer_manager_->fetch_page(next_page_id);
+        }
+        if (!prev_page || (next_page_id != INVALID_PAGE_ID && !next_page)) {
+            return false;
+        }
+        {
+            auto latch = table_page.read_latch();
+            auto new_latch = new_table_page.write_latch();
+            new_table_page.copy_from(table_page);
+        }
+        {
+            auto prev_table_page = TablePage(*std::move(prev_page));
+            auto latch = prev_table_page.write_latch();
+            prev_table_page.set_next_page_id(new_page_id);
+        }
+        if (next_page) {
+            auto next_table_page = TablePage(*std::move(next_page));
+            auto latch = next_table_page.write_latch();
+            next_table_page.set_prev_page_id(new_page_id);
+        }
+        return true;
+    }();
+    if (!linked) {
+        // the new page is not used yet
+        buffer_manager_->delete_page(new_page_id);
+        return false;
+    }
+    return buffer_manager_->delete_page(page_id);
+}
+
+tuple_id_t TableHeap::seek(const TablePage &table_page,
+                           slot_id_t slot_id,
+                           bool forward,
+                           buffer::BufferAccessStrategy *strategy) {
+    for (size_t attempt = 0;; ++attempt) {
+        // the page is read optimistically, unless it is latched exclusively or has changed under too many attempts
+        std::shared_lock<buffer::OptimisticLatch> latch;
+        uint64_t version = 0;
+        if (attempt == TablePage::OPTIMISTIC_READ_ATTEMPTS || !table_page.try_read_optimistic(version)) {
+            latch = table_page.read_latch();
+        }
+        auto consistent = [&]() { return latch.owns_lock() || table_page.validate(version); };
+
+        auto found_slot_id = forward ? table_page.next_slot(slot_id) : table_page.prev_slot(slot_id);
+        auto neighbour_page_id = forward ? table_page.next_page_id() : table_page.prev_page_id();
+        if (!consistent()) {
+            continue;
+        }
+        if (found_slot_id != INVALID_SLOT_ID) {
+            return TupleId(table_page.page_id(), found_slot_id).tuple_id();
+        }
+        if (neighbour_page_id == INVALID_PAGE_ID) {
+            return INVALID_TUPLE_ID;
+        }
+        auto neighbour_page = buffer_manager_->fetch_page(neighbour_page_id, strategy);
+        // the neighbour is still linked to the page once it is pinned if the page has not changed meanwhile, as with
+        // latch crabbing
+        if (!consistent()) {
+            continue;
+        }
+        assert(neighbour_page);
+        // except the root page, other pages must be non-empty
+        auto neighbour_slot_id = TablePage(*std::move(neighbour_page)).read([forward](const TablePage &page) {
+            return forward ? page.first_slot() : page.last_slot();
+        });
+        return TupleId(neighbour_page_id, neighbour_slot_id).tuple_id();
+    }
+}
+
 TableHeap::Iterator &TableHeap::Iterator::operator++() {
     auto [page_id, slot_id] = TupleId(tuple_id_).page_id_and_slot_id();
-    auto page = table_heap_->buffer_manager_->fetch_page(page_id);
+    auto page = table_heap_->buffer_manager_->fetch_page(page_id, strategy_);
     assert(page);
 
     auto table_page = TablePage(*std::move(page));
-    auto latch = table_page.read_latch();
-    auto next_slot_id = table_page.next_slot(slot_id);
-    // go to the next page
-    if (next_slot_id == INVALID_SLOT_ID) {
-        auto next_page_id = table_page.next_page_id();
-        if (next_page_id == INVALID_PAGE_ID) {
-            tuple_id_ = INVALID_TUPLE_ID;
-            return *this;
-        }
-        auto next_page = table_heap_->buffer_manager_->fetch_page(next_page_id);
-        assert(next_page);
-        auto next_table_page = TablePage(*std::move(next_page));
-        auto next_latch = next_table_page.read_latch();
-        next_slot_id = next_table_page.first_slot();
-        tuple_id_ = TupleId(next_page_id, next_slot_id).tuple_id();
-        return *this;
-    }
-    tuple_id_ = TupleId(page_id, next_slot_id).tuple_id();
+    tuple_id_ = table_heap_->seek(table_page, slot_id, true, strategy_);
+    // went to the next page
+    if (tuple_id_ != INVALID_TUPLE_ID && TupleId(tuple_id_).page_id() != page_id) {
+        read_ahead(TupleId(tuple_id_).page_id());
+    }
     return *this;
 }
 
@@ -198,28 +356,11 @@ TableHeap::Iterator TableHeap::Iterator::operator++(int) {
 
 TableHeap::Iterator &TableHeap::Iterator::operator--() {
     auto [page_id, slot_id] = TupleId(tuple_id_).page_id_and_slot_id();
-    auto page = table_heap_->buffer_manager_->fetch_page(page_id);
+    auto page = table_heap_->buffer_manager_->fetch_page(page_id, strategy_);
     assert(page);
 
     auto table_page = TablePage(*std::move(page));
-    auto latch = table_page.read_latch();
-    auto prev_slot_id = table_page.prev_slot(slot_id);
-    // go to the previous page
-    if (prev_slot_id == INVALID_SLOT_ID) {
-        auto prev_page_id = table_page.prev_page_id();
-        if (prev_page_id == INVALID_PAGE_ID) {
-            tuple_id_ = INVALID_TUPLE_ID;
-            return *this;
-        }
-        auto prev_page = table_heap_->buffer_manager_->fetch_page(prev_page_id);
-        assert(prev_page);
-        auto prev_table_page = TablePage(*std::move(prev_page));
-        auto prev_latch = prev_table_page.read_latch();
-        prev_slot_id = prev_table_page.last_slot();
-        tuple_id_ = TupleId(prev_page_id, prev_slot_id).tuple_id();
-        return *this;
-    }
-    tuple_id_ = TupleId(page_id, prev_slot_id).tuple_id();
+    tuple_id_ = table_heap_->seek(table_page, slot_id, false, strategy_);
     return *this;
 }
 
@@ -229,5 +370,29 @@ TableHeap::Iterator TableHeap::Iterator::operator--(int) {
     return old;
 }
 
-Tuple TableHeap::Iterator::operator*() { return *table_heap_->get_tuple(tuple_id_); }
+void TableHeap::Iterator::read_ahead(page_id_t page_id) {
+    if (read_ahead_distance_ == 0) {
+        // the iterator has caught up with the read-ahead, or is just created
+        read_ahead_page_id_ = page_id;
+    } else {
+        --read_ahead_distance_;
+    }
+    auto buffer_manager = table_heap_->buffer_manager_;
+    while (read_ahead_distance_ < READ_AHEAD_PAGES) {
+        auto page = buffer_manager->try_fetch_page(read_ahead_page_id_);
+        if (!page) {
+            // the page is still being loaded, so its successor is unknown yet
+            break;
+        }
+        auto next_page_id = TablePage(*std::move(page)).read([](const TablePage &page) { return page.next_page_id(); });
+        if (next_page_id == INVALID_PAGE_ID) {
+            break;
+        }
+        buffer_manager->prefetch({next_page_id}, strategy_);
+        read_ahead_page_id_ = next_page_id;
+        ++read_ahead_distance_;
+    }
+}
+
+Tuple TableHeap::Iterator::operator*() { return *table_heap_->get_tuple(tuple_id_, strategy_); }
 }  // namespace naivedb::storage
\ No newline at end of file
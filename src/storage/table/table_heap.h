@@ -3,13 +3,18 @@
 #include "common/constants.h"
 #include "common/types.h"
 
+#include <chrono>
+#include <functional>
 #include <optional>
+#include <stddef.h>
 
 namespace naivedb {
 namespace buffer {
+class BufferAccessStrategy;
 class BufferManager;
 }
 namespace storage {
+class TablePage;
 class Tuple;
 }
 namespace log {
@@ -21,13 +26,45 @@ class Transaction;
 }  // namespace naivedb
 
 namespace naivedb::storage {
+/**
+ * @brief The progress of a compaction, reported after each page visited.
+ *
+ */
+struct CompactionProgress {
+    size_t pages_visited_ = 0;
+    size_t pages_moved_ = 0;
+    // the number of bytes the file has shrunk by, set when the compaction finishes
+    size_t bytes_released_ = 0;
+};
+
+/**
+ * @brief Options of TableHeap::compact().
+ *
+ */
+struct CompactionOptions {
+    // the maximum number of pages moved per second, or 0 for no limit
+    size_t max_pages_per_second_ = 0;
+    // called after each page visited, if set
+    std::function<void(const CompactionProgress &)> on_progress_;
+};
+
 class TableHeap {
   public:
     class Iterator {
       public:
-        Iterator() : table_heap_(nullptr), tuple_id_(INVALID_TUPLE_ID) {}
-
-        Iterator(TableHeap *table_heap, tuple_id_t tuple_id) : table_heap_(table_heap), tuple_id_(tuple_id) {}
+        Iterator()
+            : table_heap_(nullptr)
+            , tuple_id_(INVALID_TUPLE_ID)
+            , strategy_(nullptr)
+            , read_ahead_page_id_(INVALID_PAGE_ID)
+            , read_ahead_distance_(0) {}
+
+        Iterator(TableHeap *table_heap, tuple_id_t tuple_id, buffer::BufferAccessStrategy *strategy = nullptr)
+            : table_heap_(table_heap)
+            , tuple_id_(tuple_id)
+            , strategy_(strategy)
+            , read_ahead_page_id_(INVALID_PAGE_ID)
+            , read_ahead_distance_(0) {}
 
         bool operator==(const Iterator &other) const {
             return table_heap_ == other.table_heap_ && tuple_id_ == other.tuple_id_;
@@ -48,8 +85,23 @@ class TableHeap {
         tuple_id_t tuple_id() const { return tuple_id_; }
 
       private:
+        friend class TableHeap;
+
+        /**
+         * @brief Prefetch the pages following the current page, up to READ_AHEAD_PAGES pages ahead. The page chain is
+         * followed through the pages already loaded, so the window grows as the prefetches complete.
+         *
+         * @param page_id the page the iterator has just moved to
+         */
+        void read_ahead(page_id_t page_id);
+
         TableHeap *table_heap_;
         tuple_id_t tuple_id_;
+        // the pages visited by the iterator are fetched with this strategy, if not null
+        buffer::BufferAccessStrategy *strategy_;
+        // the last page prefetched, and how many pages it is ahead of the current page
+        page_id_t read_ahead_page_id_;
+        size_t read_ahead_distance_;
     };
 
   public:
@@ -63,15 +115,70 @@ class TableHeap {
 
     bool delete_tuple(tuple_id_t tuple_id);
 
-    std::optional<Tuple> get_tuple(tuple_id_t tuple_id);
+    std::optional<Tuple> get_tuple(tuple_id_t tuple_id, buffer::BufferAccessStrategy *strategy = nullptr);
 
     bool update_tuple(tuple_id_t tuple_id, const Tuple &tuple, transaction::Transaction *txn = nullptr);
 
-    Iterator begin();
+    /**
+     * @brief Get an iterator to the first tuple of the table.
+     *
+     * @param strategy if not null, the iterator fetches pages with this strategy, so that scanning a large table does
+     * not flush the buffer pool
+     * @return Iterator
+     */
+    Iterator begin(buffer::BufferAccessStrategy *strategy = nullptr);
 
     Iterator end();
 
+    /**
+     * @brief Move the pages of the table to free pages with lower ids, so that the free space at the end of the file
+     * can be truncated. The root page is not moved.
+     *
+     * The ids of the tuples on a moved page change, so the table must not be used during the compaction. Other tables
+     * and the buffer pool stay usable.
+     *
+     * @param options
+     * @param progress updated as pages are visited and moved
+     * @return false if a page cannot be fetched or allocated, which stops the compaction
+     */
+    bool compact(const CompactionOptions &options, CompactionProgress &progress);
+
+    /**
+     * @brief Free all the pages of the table, including the root page. The table must not be used afterwards.
+     *
+     * @return false if a page cannot be fetched or is pinned, which leaves it and the pages after it allocated. The
+     * root page id is then the first page left, so that the drop can be retried.
+     */
+    bool drop();
+
   private:
+    /**
+     * @brief Find the tuple after or before a slot of a page, going on to the first tuple of the next page or the last
+     * tuple of the previous page if there is none. The pages are read optimistically.
+     *
+     * @param table_page
+     * @param slot_id the slot to start from, or INVALID_SLOT_ID to find the first tuple of the page
+     * @param forward whether to look after or before the slot
+     * @param strategy the strategy to fetch the neighbour page with
+     * @return tuple_id_t the tuple found, or INVALID_TUPLE_ID if the end of the table is reached
+     */
+    tuple_id_t seek(const TablePage &table_page,
+                    slot_id_t slot_id,
+                    bool forward,
+                    buffer::BufferAccessStrategy *strategy);
+
+    /**
+     * @brief Move a page of the table to another page, and link its neighbours to the new page.
+     *
+     * @param page_id
+     * @param new_page_id the page to move to, which is allocated and not used yet
+     * @return false if a page cannot be fetched, in which case the new page is freed and the table is left as it
+     * was, or if the moved page cannot be freed once its neighbours are linked to the new page
+     */
+    bool move_page(page_id_t page_id, page_id_t new_page_id);
+
+    static constexpr size_t READ_AHEAD_PAGES = 8;
+
     buffer::BufferManager *buffer_manager_;
     page_id_t root_page_id_;
 
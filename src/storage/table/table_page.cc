@@ -4,9 +4,15 @@
 #include "storage/tuple/tuple.h"
 #include "storage/tuple/tuple_id.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 
 namespace naivedb::storage {
+void TablePage::copy_from(const TablePage &table_page) {
+    std::memcpy(page_.data_mut(), table_page.page_.data(), PAGE_SIZE);
+}
+
 void TablePage::init(page_id_t prev_page_id) {
     page_.clear();
     set_lsn(INVALID_LSN);
@@ -75,7 +81,7 @@ bool TablePage::delete_tuple(slot_id_t slot_id) {
 }
 
 std::optional<Tuple> TablePage::get_tuple(slot_id_t slot_id) const {
-    if (slot_id >= slot_count()) {
+    if (slot_id < 0 || slot_id >= slot_limit()) {
         return std::nullopt;
     }
     if (tuple_deleted(slot_id)) {
@@ -83,6 +89,9 @@ std::optional<Tuple> TablePage::get_tuple(slot_id_t slot_id) const {
     }
     auto tuple_offset = this->tuple_offset(slot_id);
     auto tuple_size = this->tuple_size(slot_id);
+    if (tuple_offset > PAGE_SIZE || tuple_size > PAGE_SIZE - tuple_offset) {
+        return std::nullopt;
+    }
 
     std::vector<char> tuple_data(page_.data() + tuple_offset, page_.data() + tuple_offset + tuple_size);
     return Tuple(std::move(tuple_data));
@@ -108,7 +117,7 @@ bool TablePage::update_tuple(slot_id_t slot_id, const Tuple &tuple) {
 }
 
 slot_id_t TablePage::first_slot() const {
-    for (slot_id_t slot_id = 0; slot_id < slot_count(); ++slot_id) {
+    for (slot_id_t slot_id = 0; slot_id < slot_limit(); ++slot_id) {
         if (!tuple_deleted(slot_id)) {
             return slot_id;
         }
@@ -117,7 +126,7 @@ slot_id_t TablePage::first_slot() const {
 }
 
 slot_id_t TablePage::next_slot(slot_id_t slot_id) const {
-    for (++slot_id; slot_id < slot_count(); ++slot_id) {
+    for (++slot_id; slot_id < slot_limit(); ++slot_id) {
         if (!tuple_deleted(slot_id)) {
             return slot_id;
         }
@@ -126,7 +135,7 @@ slot_id_t TablePage::next_slot(slot_id_t slot_id) const {
 }
 
 slot_id_t TablePage::prev_slot(slot_id_t slot_id) const {
-    for (--slot_id; slot_id >= 0; --slot_id) {
+    for (slot_id = std::min(slot_id, slot_limit()) - 1; slot_id >= 0; --slot_id) {
         if (!tuple_deleted(slot_id)) {
             return slot_id;
         }
@@ -135,7 +144,7 @@ slot_id_t TablePage::prev_slot(slot_id_t slot_id) const {
 }
 
 slot_id_t TablePage::last_slot() const {
-    for (slot_id_t slot_id = slot_count() - 1; slot_id >= 0; --slot_id) {
+    for (slot_id_t slot_id = slot_limit() - 1; slot_id >= 0; --slot_id) {
         if (!tuple_deleted(slot_id)) {
             return slot_id;
         }
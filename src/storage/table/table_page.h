@@ -1,9 +1,12 @@
 #pragma once
 
+#include "buffer/optimistic_latch.h"
+#include "common/constants.h"
 #include "common/macros.h"
 #include "common/types.h"
 #include "storage/page/page_guard.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <mutex>
 #include <optional>
@@ -29,6 +32,9 @@ namespace naivedb::storage {
  !*  ---------------------------------------------------------------------------------------------------------------------------
  !* | lsn (8) | prev_page_id (8) | next_page_id (8) | free_space_pointer (4) | slot_count (4) | tuple_count (4) | (padding) (4) |
  !*  ---------------------------------------------------------------------------------------------------------------------------
+ *
+ * The const readers may run on a page being modified, as optimistic reads do, so they never read or copy out of the
+ * bounds of the page whatever the header and the slot array hold.
  */
 class TablePage {
     DISALLOW_COPY(TablePage)
@@ -62,12 +68,64 @@ class TablePage {
 
     ~TablePage() = default;
 
-    std::shared_lock<std::shared_mutex> read_latch() const { return std::shared_lock(page_.rwlatch()); }
-
-    std::unique_lock<std::shared_mutex> write_latch() const { return std::unique_lock(page_.rwlatch()); }
+    std::shared_lock<buffer::OptimisticLatch> read_latch() const { return std::shared_lock(page_.rwlatch()); }
+
+    /**
+     * @brief Latch the page exclusively. Every modification of the page must be made under this latch, which also
+     * invalidates the optimistic reads in progress.
+     *
+     * @return std::unique_lock<buffer::OptimisticLatch>
+     */
+    std::unique_lock<buffer::OptimisticLatch> write_latch() const { return std::unique_lock(page_.rwlatch()); }
+
+    /**
+     * @brief Start an optimistic read of the page, which takes no latch.
+     *
+     * @param version set to the version to validate the read with
+     * @return false if the page is latched exclusively
+     */
+    bool try_read_optimistic(uint64_t &version) const { return page_.rwlatch().try_read_optimistic(version); }
+
+    /**
+     * @brief Check that the page has not been modified since an optimistic read started.
+     *
+     * @param version
+     * @return true if what was read since is consistent
+     */
+    bool validate(uint64_t version) const { return page_.rwlatch().validate(version); }
+
+    /**
+     * @brief Run a reader on the page optimistically, and retry it until it reads a consistent page. If the page is
+     * latched exclusively or keeps changing, the reader is run under the shared latch instead.
+     *
+     * @param reader a function reading the page through its const methods
+     * @return the result of the reader
+     */
+    template <typename Reader>
+    auto read(Reader &&reader) const {
+        for (size_t attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; ++attempt) {
+            uint64_t version;
+            if (!try_read_optimistic(version)) {
+                break;
+            }
+            auto result = reader(*this);
+            if (validate(version)) {
+                return result;
+            }
+        }
+        auto latch = read_latch();
+        return reader(*this);
+    }
 
     void init(page_id_t prev_page_id);
 
+    /**
+     * @brief Overwrite the page with a copy of another table page, including its links.
+     *
+     * @param table_page the page to copy, which must be latched too
+     */
+    void copy_from(const TablePage &table_page);
+
     slot_id_t insert_tuple(const Tuple &tuple);
 
     bool delete_tuple(slot_id_t slot_id);
@@ -97,6 +155,8 @@ class TablePage {
 
     uint32_t tuple_count() const { return header()->tuple_count_; }
 
+    static constexpr size_t OPTIMISTIC_READ_ATTEMPTS = 4;
+
   private:
     void set_tuple_count(uint32_t tuple_count) { header()->tuple_count_ = tuple_count; }
 
@@ -106,6 +166,14 @@ class TablePage {
     void set_free_space_pointer(uint32_t free_space_pointer) { header()->free_space_pointer_ = free_space_pointer; }
 
     slot_id_t slot_count() const { return header()->slot_count_; }
+
+    /**
+     * @brief Get the number of slots, capped by the number of slots a page can hold so that a torn header does not
+     * send a reader out of the page.
+     *
+     * @return slot_id_t
+     */
+    slot_id_t slot_limit() const { return std::min<uint32_t>(header()->slot_count_, MAX_SLOT_COUNT); }
     void set_slot_count(slot_id_t slot_count) { header()->slot_count_ = slot_count; }
 
     uint32_t tuple_offset(slot_id_t slot_id) const { return slots()[slot_id].offset_; }
@@ -127,6 +195,7 @@ class TablePage {
     static constexpr size_t OFFSET_SLOT_ARRAY = sizeof(Header);
     static constexpr size_t SLOT_SIZE = sizeof(Slot);
     static constexpr size_t HEADER_SIZE = sizeof(Header);
+    static constexpr uint32_t MAX_SLOT_COUNT = (PAGE_SIZE - HEADER_SIZE) / SLOT_SIZE;
 
     PageGuard page_;
 };
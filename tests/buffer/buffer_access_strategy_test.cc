@@ -0,0 +1,93 @@
+#include "buffer/buffer_access_strategy.h"
+#include "buffer/buffer_manager.h"
+#include "common/constants.h"
+#include "common/types.h"
+#include "io/disk_manager.h"
+#include "storage/page/page_guard.h"
+#include "test_utils.h"
+
+#include <cstring>
+#include <fmt/core.h>
+#include <optional>
+#include <vector>
+
+using namespace naivedb;
+
+constexpr size_t POOL_SIZE = 64;
+constexpr size_t HOT_PAGES = 32;
+constexpr page_id_t SCAN_PAGES = 256;
+constexpr size_t RING_SIZE = 8;
+
+/**
+ * @brief Scan a table larger than the pool after warming up a hot set, and count the hot pages still cached. A cached
+ * page is detected by overwriting its copy on disk behind the buffer manager's back.
+ *
+ * @return size_t the number of hot pages still in the buffer pool after the scan
+ */
+size_t scan_and_count_cached_hot_pages(size_t partitions, bool use_strategy, bool dirty_scan) {
+    remove("test.db");
+    io::DiskManager dm("test.db");
+    buffer::BufferManager bm(POOL_SIZE, &dm, partitions);
+
+    std::vector<page_id_t> hot_page_ids, scan_page_ids;
+    for (size_t i = 0; i < HOT_PAGES + SCAN_PAGES; ++i) {
+        auto page = bm.new_page();
+        TEST_ASSERT_NE(page, std::nullopt);
+        auto page_id = page->page_id();
+        std::memcpy(page->data_mut(), &page_id, sizeof(page_id));
+        (i < HOT_PAGES ? hot_page_ids : scan_page_ids).emplace_back(page_id);
+    }
+    bm.flush_all_pages();
+    for (auto page_id : hot_page_ids) {
+        TEST_ASSERT_NE(bm.fetch_page(page_id), std::nullopt);
+    }
+
+    buffer::BufferAccessStrategy strategy(RING_SIZE);
+    for (int round = 0; round < 2; ++round) {
+        for (auto page_id : scan_page_ids) {
+            auto page = bm.fetch_page(page_id, use_strategy ? &strategy : nullptr);
+            TEST_ASSERT_NE(page, std::nullopt);
+            page_id_t stored;
+            std::memcpy(&stored, page->data(), sizeof(stored));
+            // the second round sees the updates of the first one, which must survive the recycling of the ring
+            TEST_ASSERT_EQ(stored, dirty_scan && round == 1 ? page_id + SCAN_PAGES : page_id);
+            if (dirty_scan && round == 0) {
+                stored = page_id + SCAN_PAGES;
+                std::memcpy(page->data_mut(), &stored, sizeof(stored));
+            }
+        }
+    }
+
+    char buf[PAGE_SIZE];
+    std::memset(buf, 0xff, PAGE_SIZE);
+    for (auto page_id : hot_page_ids) {
+        dm.write_page(page_id, buf);
+    }
+    size_t cached = 0;
+    for (auto page_id : hot_page_ids) {
+        auto page = bm.fetch_page(page_id);
+        TEST_ASSERT_NE(page, std::nullopt);
+        page_id_t stored;
+        std::memcpy(&stored, page->data(), sizeof(stored));
+        if (stored == page_id) {
+            ++cached;
+        }
+    }
+    remove("test.db");
+    return cached;
+}
+
+int main() {
+    for (size_t partitions : {1, 4}) {
+        fmt::print("test scan with {} partitions...\n", partitions);
+        // without a strategy, the scan flushes the whole pool
+        TEST_ASSERT_EQ(scan_and_count_cached_hot_pages(partitions, false, false), 0);
+        // with a strategy, the scan only takes the frames of its ring
+        for (bool dirty_scan : {false, true}) {
+            auto cached = scan_and_count_cached_hot_pages(partitions, true, dirty_scan);
+            fmt::print("{} of {} hot pages cached\n", cached, HOT_PAGES);
+            TEST_ASSERT_EQ(cached, HOT_PAGES);
+        }
+    }
+    return EXIT_SUCCESS;
+}
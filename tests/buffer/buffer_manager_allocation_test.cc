@@ -0,0 +1,91 @@
+#include "buffer/buffer_manager.h"
+#include "buffer/replacer.h"
+#include "common/constants.h"
+#include "common/types.h"
+#include "io/disk_manager.h"
+#include "storage/page/page_guard.h"
+#include "test_utils.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/core.h>
+#include <new>
+#include <optional>
+#include <vector>
+
+using namespace naivedb;
+
+constexpr size_t POOL_SIZE = 16;
+constexpr size_t PARTITIONS = 4;
+constexpr size_t PAGES = 64;
+constexpr size_t ROUNDS = 10;
+
+// the number of allocations made by any thread while counting is enabled
+std::atomic<size_t> allocations = 0;
+std::atomic<bool> counting = false;
+
+void *operator new(size_t size) {
+    if (counting.load()) {
+        ++allocations;
+    }
+    if (void *ptr = std::malloc(size > 0 ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+/**
+ * @brief Count the allocations made by fetching pages, both hits and misses, and by moving and dropping the guards.
+ *
+ */
+size_t count_fetch_allocations(buffer::ReplacementPolicy policy) {
+    remove("test.db");
+    io::DiskManager dm("test.db");
+    buffer::BufferManager bm(POOL_SIZE, &dm, PARTITIONS, policy);
+
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < PAGES; ++i) {
+        auto page = bm.new_page();
+        TEST_ASSERT_NE(page, std::nullopt);
+        auto page_id = page->page_id();
+        std::memcpy(page->data_mut(), &page_id, sizeof(page_id));
+        page_ids.emplace_back(page_id);
+    }
+
+    size_t failures = 0;
+    allocations.store(0);
+    counting.store(true);
+    for (size_t round = 0; round < ROUNDS; ++round) {
+        for (auto page_id : page_ids) {
+            // each page is fetched twice in a row, so that there are both hits and misses
+            for (int i = 0; i < 2; ++i) {
+                auto page = bm.fetch_page(page_id);
+                if (!page) {
+                    ++failures;
+                    continue;
+                }
+                storage::PageGuard guard = *std::move(page);
+                if (std::memcmp(guard.data(), &page_id, sizeof(page_id)) != 0) {
+                    ++failures;
+                }
+            }
+        }
+    }
+    counting.store(false);
+    TEST_ASSERT_EQ(failures, 0);
+    remove("test.db");
+    return allocations.load();
+}
+
+int main() {
+    fmt::print("test allocations of fetch_page...\n");
+    TEST_ASSERT_EQ(count_fetch_allocations(buffer::ReplacementPolicy::Lru), 0);
+    TEST_ASSERT_EQ(count_fetch_allocations(buffer::ReplacementPolicy::Clock), 0);
+    fmt::print("passed!\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,207 @@
+#include "buffer/buffer_manager.h"
+#include "common/constants.h"
+#include "common/task_queue.h"
+#include "common/types.h"
+#include "io/memory_storage.h"
+#include "storage/page/page_guard.h"
+#include "test_utils.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+using namespace naivedb;
+
+constexpr size_t POOL_SIZE = 128;
+constexpr size_t PARTITIONS = 4;
+constexpr size_t PAGES = 100;
+constexpr size_t WRITERS = 4;
+constexpr size_t WRITES_PER_WRITER = 2000;
+
+// the first bytes of each page hold its id, and the next ones a version
+void write_version(buffer::BufferManager &bm, page_id_t page_id, uint32_t version) {
+    auto page = bm.fetch_page(page_id);
+    TEST_ASSERT_NE(page, std::nullopt);
+    std::unique_lock latch(page->rwlatch());
+    std::memcpy(page->data_mut() + sizeof(page_id), &version, sizeof(version));
+}
+
+uint32_t stored_version(io::MemoryStorage &storage, page_id_t page_id) {
+    char buf[PAGE_SIZE];
+    storage.read_page(page_id, buf);
+    TEST_ASSERT_EQ(std::memcmp(buf, &page_id, sizeof(page_id)), 0);
+    uint32_t version;
+    std::memcpy(&version, buf + sizeof(page_id), sizeof(version));
+    return version;
+}
+
+void test_checkpoint() {
+    io::MemoryStorage storage;
+    buffer::BufferManager bm(POOL_SIZE, &storage, PARTITIONS);
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < PAGES; ++i) {
+        auto page = bm.new_page();
+        TEST_ASSERT_NE(page, std::nullopt);
+        auto page_id = page->page_id();
+        std::memcpy(page->data_mut(), &page_id, sizeof(page_id));
+        page_ids.emplace_back(page_id);
+    }
+
+    buffer::CheckpointProgress progress;
+    TEST_ASSERT_EQ(bm.last_checkpoint(), 0);
+    auto epoch = bm.checkpoint({}, progress);
+    TEST_ASSERT_EQ(bm.last_checkpoint(), epoch);
+    TEST_ASSERT_EQ(progress.dirty_pages_, PAGES);
+    TEST_ASSERT_EQ(progress.pages_written_, PAGES);
+    for (auto page_id : page_ids) {
+        TEST_ASSERT_EQ(stored_version(storage, page_id), 0);
+    }
+
+    // clean pages are skipped, and a page modified under a guard that is still held is written
+    progress = {};
+    write_version(bm, page_ids[3], 1);
+    write_version(bm, page_ids[50], 1);
+    {
+        auto page = bm.fetch_page(page_ids[7]);
+        uint32_t version = 1;
+        std::memcpy(page->data_mut() + sizeof(page_id_t), &version, sizeof(version));
+        epoch = bm.checkpoint({}, progress);
+        TEST_ASSERT_EQ(progress.dirty_pages_, 3);
+        TEST_ASSERT_EQ(progress.pages_written_, 3);
+        TEST_ASSERT_EQ(stored_version(storage, page_ids[7]), 1);
+    }
+    TEST_ASSERT_EQ(stored_version(storage, page_ids[3]), 1);
+    TEST_ASSERT_EQ(stored_version(storage, page_ids[50]), 1);
+    // the release of the guard makes the page dirty again
+    progress = {};
+    TEST_ASSERT_EQ(bm.checkpoint({}, progress), epoch + 1);
+    TEST_ASSERT_EQ(progress.pages_written_, 1);
+
+    // all the pages are dirty and written in two batches. The pages dirtied during the checkpoint are left to the next
+    // one, and the pages written back by someone else are skipped.
+    for (auto page_id : page_ids) {
+        write_version(bm, page_id, 2);
+    }
+    progress = {};
+    buffer::CheckpointOptions options;
+    options.max_pages_per_second_ = 1000;
+    options.on_progress_ = [&](const buffer::CheckpointProgress &progress) {
+        if (progress.pages_written_ < PAGES - 1) {
+            write_version(bm, page_ids[0], 3);
+            bm.flush_page(page_ids[PAGES - 1]);
+        }
+    };
+    auto start = std::chrono::steady_clock::now();
+    bm.checkpoint(options, progress);
+    TEST_ASSERT(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(60));
+    TEST_ASSERT_EQ(progress.dirty_pages_, PAGES);
+    TEST_ASSERT_EQ(progress.pages_written_, PAGES - 1);
+    TEST_ASSERT_EQ(progress.pages_skipped_, 1);
+    TEST_ASSERT_EQ(stored_version(storage, page_ids[0]), 2);
+    TEST_ASSERT_EQ(stored_version(storage, page_ids[PAGES - 1]), 2);
+    progress = {};
+    bm.checkpoint({}, progress);
+    TEST_ASSERT_EQ(progress.pages_written_, 1);
+    TEST_ASSERT_EQ(stored_version(storage, page_ids[0]), 3);
+}
+
+void test_long_held_guard() {
+    io::MemoryStorage storage;
+    buffer::BufferManager bm(POOL_SIZE, &storage, PARTITIONS);
+    auto page = bm.new_page();
+    TEST_ASSERT_NE(page, std::nullopt);
+    auto page_id = page->page_id();
+    std::memcpy(page->data_mut(), &page_id, sizeof(page_id));
+
+    // each checkpoint writes the modifications made through the guard before it, although the guard is never released
+    for (uint32_t version = 1; version <= 3; ++version) {
+        {
+            std::unique_lock latch(page->rwlatch());
+            std::memcpy(page->data_mut() + sizeof(page_id), &version, sizeof(version));
+        }
+        buffer::CheckpointProgress progress;
+        bm.checkpoint({}, progress);
+        TEST_ASSERT_EQ(progress.pages_written_, 1);
+        TEST_ASSERT_EQ(stored_version(storage, page_id), version);
+    }
+    buffer::CheckpointProgress progress;
+    bm.checkpoint({}, progress);
+    TEST_ASSERT_EQ(progress.pages_written_, 0);
+
+    // a checkpoint waits for a modification made under the exclusive latch, rather than writing a torn page
+    std::atomic<bool> checkpointed = false;
+    std::thread checkpointer;
+    {
+        std::unique_lock latch(page->rwlatch());
+        uint32_t version = 4;
+        std::memcpy(page->data_mut() + sizeof(page_id), &version, sizeof(version));
+        checkpointer = std::thread([&]() {
+            buffer::CheckpointProgress progress;
+            bm.checkpoint({}, progress);
+            checkpointed.store(true);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        TEST_ASSERT(!checkpointed.load());
+        std::memset(page->data_mut() + PAGE_SIZE / 2, 1, PAGE_SIZE / 2);
+    }
+    checkpointer.join();
+    TEST_ASSERT_EQ(stored_version(storage, page_id), 4);
+    char buf[PAGE_SIZE];
+    storage.read_page(page_id, buf);
+    TEST_ASSERT_EQ(buf[PAGE_SIZE - 1], 1);
+}
+
+void test_concurrent_checkpoints() {
+    io::MemoryStorage storage;
+    buffer::BufferManager bm(POOL_SIZE / 2, &storage, PARTITIONS);
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < PAGES; ++i) {
+        auto page = bm.new_page();
+        TEST_ASSERT_NE(page, std::nullopt);
+        auto page_id = page->page_id();
+        std::memcpy(page->data_mut(), &page_id, sizeof(page_id));
+        page_ids.emplace_back(page_id);
+    }
+
+    // each writer owns a slice of the pages and raises their versions, while checkpoints run and pages are evicted
+    std::atomic<bool> done = false;
+    std::vector<std::vector<uint32_t>> versions(WRITERS, std::vector<uint32_t>(PAGES / WRITERS, 0));
+    TaskQueue tasks;
+    for (size_t t = 0; t < WRITERS; ++t) {
+        tasks.push([&, t]() {
+            std::mt19937 rng(t);
+            for (size_t i = 0; i < WRITES_PER_WRITER; ++i) {
+                auto index = rng() % versions[t].size();
+                write_version(bm, page_ids[t * versions[t].size() + index], ++versions[t][index]);
+            }
+        });
+    }
+    std::thread checkpointer([&]() {
+        while (!done.load()) {
+            buffer::CheckpointProgress progress;
+            bm.checkpoint({}, progress);
+        }
+    });
+    tasks.wait();
+    done.store(true);
+    checkpointer.join();
+
+    bm.flush_all_pages();
+    for (size_t t = 0; t < WRITERS; ++t) {
+        for (size_t index = 0; index < versions[t].size(); ++index) {
+            TEST_ASSERT_EQ(stored_version(storage, page_ids[t * versions[t].size() + index]), versions[t][index]);
+        }
+    }
+}
+
+int main() {
+    test_checkpoint();
+    test_long_held_guard();
+    test_concurrent_checkpoints();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,495 @@
+#include "buffer/buffer_manager.h"
+#include "common/constants.h"
+#include "common/task_queue.h"
+#include "common/types.h"
+#include "io/disk_manager.h"
+#include "io/memory_storage.h"
+#include "storage/page/page_guard.h"
+#include "test_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fmt/core.h>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <shared_mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace naivedb;
+
+constexpr size_t HIT_POOL_SIZE = 64;
+constexpr size_t HIT_PARTITIONS = 16;
+constexpr size_t HIT_FETCHES_PER_THREAD = 100000;
+
+constexpr size_t EVICT_POOL_SIZE = 32;
+constexpr size_t EVICT_PARTITIONS = 4;
+constexpr size_t EVICT_PAGES = 256;
+constexpr size_t EVICT_THREADS = 4;
+constexpr size_t EVICT_ROUNDS = 2000;
+
+constexpr size_t CLEAN_POOL_SIZE = 16;
+constexpr size_t CLEAN_PARTITIONS = 2;
+
+constexpr size_t PREFETCH_POOL_SIZE = 16;
+constexpr size_t PREFETCH_PAGES = 64;
+
+constexpr size_t MISS_POOL_SIZE = 8;
+constexpr size_t MISS_PAGES = 64;
+constexpr size_t MISS_THREADS = 8;
+constexpr size_t MISS_ROUNDS = 500;
+
+constexpr size_t RESIZE_PARTITIONS = 4;
+constexpr size_t RESIZE_PAGES = 256;
+constexpr size_t RESIZE_THREADS = 4;
+constexpr size_t RESIZE_ROUNDS = 5000;
+constexpr size_t RESIZE_SIZES[] = {16, 200, 8, 64, 300, 32};
+
+void test_hit() {
+    fmt::print("test concurrent fetch hits...\n");
+    remove("test.db");
+    io::DiskManager dm("test.db");
+    buffer::BufferManager bm(HIT_POOL_SIZE, &dm, HIT_PARTITIONS);
+    TEST_ASSERT_EQ(bm.partitions(), HIT_PARTITIONS);
+
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < HIT_POOL_SIZE; ++i) {
+        auto page = bm.new_page();
+        TEST_ASSERT_NE(page, std::nullopt);
+        auto page_id = page->page_id();
+        std::memcpy(page->data_mut(), &page_id, sizeof(page_id));
+        page_ids.emplace_back(page_id);
+    }
+
+    // all the pages are resident, so every fetch below is a buffer hit
+    for (size_t thread_count : {1, 2, 4, 8}) {
+        std::atomic<size_t> failures = 0;
+        TaskQueue tasks;
+        for (size_t t = 0; t < thread_count; ++t) {
+            tasks.push([&, t]() {
+                std::mt19937 rng(t);
+                for (size_t i = 0; i < HIT_FETCHES_PER_THREAD; ++i) {
+                    auto page_id = page_ids[rng() % page_ids.size()];
+                    auto page = bm.fetch_page(page_id);
+                    if (!page || std::memcmp(page->data(), &page_id, sizeof(page_id)) != 0) {
+                        ++failures;
+                    }
+                }
+            });
+        }
+        auto start = std::chrono::steady_clock::now();
+        tasks.wait();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        TEST_ASSERT_EQ(failures.load(), 0);
+        fmt::print("{} thread(s): {:.0f} fetches/s\n",
+                   thread_count,
+                   thread_count * HIT_FETCHES_PER_THREAD / elapsed.count());
+    }
+    fmt::print("passed!\n");
+}
+
+// a storage whose first page write blocks until released
+class BlockedWriteStorage : public io::MemoryStorage {
+  public:
+    void write_page_aligned(page_id_t page_id, const char *page_data) override {
+        std::unique_lock latch(latch_);
+        if (!blocked_) {
+            blocked_ = true;
+            cv_.notify_all();
+            cv_.wait(latch, [this]() { return released_; });
+        }
+        latch.unlock();
+        MemoryStorage::write_page_aligned(page_id, page_data);
+    }
+
+    void wait_blocked() {
+        std::unique_lock latch(latch_);
+        cv_.wait(latch, [this]() { return blocked_; });
+    }
+
+    void release() {
+        std::lock_guard latch(latch_);
+        released_ = true;
+        cv_.notify_all();
+    }
+
+  private:
+    std::mutex latch_;
+    std::condition_variable cv_;
+    bool blocked_ = false;
+    bool released_ = false;
+};
+
+void test_evict_cleaned() {
+    // an eviction skipping the frame being cleaned puts it back as the next victim, so that it is evicted once clean
+    BlockedWriteStorage storage;
+    buffer::BufferManager bm(CLEAN_POOL_SIZE, &storage);
+    for (size_t i = 0; i < CLEAN_POOL_SIZE; ++i) {
+        auto page = bm.new_page();
+        TEST_ASSERT_NE(page, std::nullopt);
+        page->data_mut();
+    }
+    std::thread cleaner([&]() { TEST_ASSERT_EQ(bm.clean_victim_candidates(1.0 / CLEAN_POOL_SIZE, 1), 1); });
+    storage.wait_blocked();
+    TEST_ASSERT_NE(bm.new_page(), std::nullopt);
+    storage.release();
+    cleaner.join();
+    TEST_ASSERT_EQ(bm.stats().dirty_evictions_, 1);
+    TEST_ASSERT_NE(bm.new_page(), std::nullopt);
+    auto stats = bm.stats();
+    TEST_ASSERT_EQ(stats.evictions_, 2);
+    TEST_ASSERT_EQ(stats.dirty_evictions_, 1);
+}
+
+void test_evict(buffer::ReplacementPolicy policy, bool background_writer) {
+    fmt::print("test concurrent fetch with eviction...\n");
+    remove("test.db");
+    io::DiskManager dm("test.db");
+    buffer::BufferManager bm(EVICT_POOL_SIZE, &dm, EVICT_PARTITIONS, policy);
+    if (background_writer) {
+        test_evict_cleaned();
+        buffer::BackgroundWriterOptions options;
+        options.clean_fraction_ = 0.5;
+        options.interval_ = std::chrono::milliseconds(1);
+        bm.start_background_writer(options);
+    }
+
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < EVICT_PAGES; ++i) {
+        auto page = bm.new_page();
+        TEST_ASSERT_NE(page, std::nullopt);
+        page_ids.emplace_back(page->page_id());
+    }
+
+    // each thread owns the pages whose index modulo EVICT_THREADS equals its id, and bumps a counter in them
+    std::vector<std::vector<uint64_t>> counters(EVICT_THREADS, std::vector<uint64_t>(EVICT_PAGES));
+    std::atomic<size_t> failures = 0;
+    TaskQueue tasks;
+    for (size_t t = 0; t < EVICT_THREADS; ++t) {
+        tasks.push([&, t]() {
+            std::mt19937 rng(t);
+            for (size_t i = 0; i < EVICT_ROUNDS; ++i) {
+                size_t index = rng() % (EVICT_PAGES / EVICT_THREADS) * EVICT_THREADS + t;
+                auto page = bm.fetch_page(page_ids[index]);
+                if (!page) {
+                    ++failures;
+                    continue;
+                }
+                std::unique_lock latch(page->rwlatch());
+                uint64_t counter;
+                std::memcpy(&counter, page->data(), sizeof(counter));
+                if (counter != counters[t][index]) {
+                    ++failures;
+                }
+                ++counter;
+                std::memcpy(page->data_mut(), &counter, sizeof(counter));
+                counters[t][index] = counter;
+            }
+        });
+    }
+    tasks.wait();
+    TEST_ASSERT_EQ(failures.load(), 0);
+    bm.stop_background_writer();
+    auto stats = bm.stats();
+    fmt::print("{} evictions, {} dirty, {} background writes\n",
+               stats.evictions_,
+               stats.dirty_evictions_,
+               stats.background_writes_);
+
+    bm.flush_all_pages();
+    char buf[PAGE_SIZE];
+    for (size_t i = 0; i < EVICT_PAGES; ++i) {
+        dm.read_page(page_ids[i], buf);
+        uint64_t counter;
+        std::memcpy(&counter, buf, sizeof(counter));
+        TEST_ASSERT_EQ(counter, counters[i % EVICT_THREADS][i]);
+    }
+    fmt::print("passed!\n");
+}
+
+void test_clean() {
+    fmt::print("test background writer round...\n");
+    remove("test.db");
+    io::DiskManager dm("test.db");
+    buffer::BufferManager bm(CLEAN_POOL_SIZE, &dm, CLEAN_PARTITIONS);
+
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < CLEAN_POOL_SIZE; ++i) {
+        auto page = bm.new_page();
+        TEST_ASSERT_NE(page, std::nullopt);
+        auto page_id = page->page_id();
+        std::memcpy(page->data_mut(), &page_id, sizeof(page_id));
+        page_ids.emplace_back(page_id);
+    }
+    {
+        // pinned pages are never written
+        auto pinned = bm.fetch_page(page_ids[0]);
+        TEST_ASSERT_EQ(bm.clean_victim_candidates(1, CLEAN_POOL_SIZE), CLEAN_POOL_SIZE - 1);
+        TEST_ASSERT_EQ(bm.clean_victim_candidates(1, CLEAN_POOL_SIZE), 0);
+        pinned->data_mut();
+    }
+    // only the next victims are written, within the limit of the round
+    TEST_ASSERT_EQ(bm.clean_victim_candidates(0.5, CLEAN_POOL_SIZE), 0);
+    TEST_ASSERT_EQ(bm.clean_victim_candidates(1, CLEAN_POOL_SIZE), 1);
+
+    char buf[PAGE_SIZE];
+    for (auto page_id : page_ids) {
+        dm.read_page(page_id, buf);
+        TEST_ASSERT_EQ(std::memcmp(buf, &page_id, sizeof(page_id)), 0);
+    }
+    // the pool is clean, so no eviction has to write a page
+    for (size_t i = 0; i < CLEAN_POOL_SIZE; ++i) {
+        TEST_ASSERT_NE(bm.new_page(), std::nullopt);
+    }
+    auto stats = bm.stats();
+    TEST_ASSERT_EQ(stats.evictions_, CLEAN_POOL_SIZE);
+    TEST_ASSERT_EQ(stats.dirty_evictions_, 0);
+    TEST_ASSERT_EQ(stats.background_writes_, CLEAN_POOL_SIZE);
+    fmt::print("passed!\n");
+}
+
+void test_prefetch(io::IoBackend backend) {
+    fmt::print("test prefetch...\n");
+    remove("test.db");
+    io::DiskManager dm("test.db", backend);
+    std::vector<page_id_t> page_ids;
+    {
+        buffer::BufferManager bm(PREFETCH_POOL_SIZE, &dm);
+        for (size_t i = 0; i < PREFETCH_PAGES; ++i) {
+            auto page = bm.new_page();
+            TEST_ASSERT_NE(page, std::nullopt);
+            auto page_id = page->page_id();
+            std::memcpy(page->data_mut(), &page_id, sizeof(page_id));
+            page_ids.emplace_back(page_id);
+        }
+        bm.flush_all_pages();
+    }
+
+    buffer::BufferManager bm(PREFETCH_POOL_SIZE, &dm);
+    std::vector<page_id_t> prefetched(page_ids.begin(), page_ids.begin() + PREFETCH_POOL_SIZE / 2);
+    for (auto page_id : prefetched) {
+        TEST_ASSERT_EQ(bm.try_fetch_page(page_id), std::nullopt);
+    }
+    bm.prefetch(prefetched);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    for (auto page_id : prefetched) {
+        std::optional<storage::PageGuard> page;
+        while (!(page = bm.try_fetch_page(page_id))) {
+            TEST_ASSERT(std::chrono::steady_clock::now() < deadline);
+            std::this_thread::yield();
+        }
+        TEST_ASSERT_EQ(std::memcmp(page->data(), &page_id, sizeof(page_id)), 0);
+    }
+    // fetching a page being prefetched waits for the read
+    bm.prefetch(page_ids);
+    for (auto page_id : page_ids) {
+        auto page = bm.fetch_page(page_id);
+        TEST_ASSERT_NE(page, std::nullopt);
+        TEST_ASSERT_EQ(std::memcmp(page->data(), &page_id, sizeof(page_id)), 0);
+    }
+    fmt::print("passed!\n");
+}
+
+// a storage whose batched reads block until released
+class BlockedReadStorage : public io::MemoryStorage {
+  public:
+    io_ticket_t submit(IoRequest *requests, size_t count) override {
+        std::unique_lock latch(latch_);
+        ++blocked_;
+        cv_.notify_all();
+        cv_.wait(latch, [this]() { return released_; });
+        latch.unlock();
+        return MemoryStorage::submit(requests, count);
+    }
+
+    void wait_blocked() {
+        std::unique_lock latch(latch_);
+        cv_.wait(latch, [this]() { return blocked_ > 0; });
+    }
+
+    void release() {
+        std::lock_guard latch(latch_);
+        released_ = true;
+        cv_.notify_all();
+    }
+
+  private:
+    std::mutex latch_;
+    std::condition_variable cv_;
+    size_t blocked_ = 0;
+    bool released_ = false;
+};
+
+void test_prefetch_after_shrink() {
+    fmt::print("test prefetch after shrinking the pool...\n");
+    BlockedReadStorage storage;
+    std::vector<page_id_t> page_ids;
+    {
+        buffer::BufferManager bm(PREFETCH_POOL_SIZE, &storage);
+        for (size_t i = 0; i < PREFETCH_PAGES; ++i) {
+            auto page = bm.new_page();
+            TEST_ASSERT_NE(page, std::nullopt);
+            page_ids.emplace_back(page->page_id());
+        }
+        bm.flush_all_pages();
+    }
+
+    buffer::BufferManager bm(PREFETCH_PAGES * 8, &storage);
+    TEST_ASSERT_EQ(bm.resize(PREFETCH_POOL_SIZE), PREFETCH_POOL_SIZE);
+
+    // the batches stuck in the storage keep their frames pinned, but they are sized for the shrunk pool
+    bm.prefetch(page_ids);
+    storage.wait_blocked();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    TEST_ASSERT_NE(bm.new_page(), std::nullopt);
+    storage.release();
+    fmt::print("passed!\n");
+}
+
+void test_miss() {
+    fmt::print("test concurrent fetch misses on shared pages...\n");
+    remove("test.db");
+    io::DiskManager dm("test.db");
+    buffer::BufferManager bm(MISS_POOL_SIZE, &dm);
+
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < MISS_PAGES; ++i) {
+        auto page = bm.new_page();
+        TEST_ASSERT_NE(page, std::nullopt);
+        auto page_id = page->page_id();
+        std::memcpy(page->data_mut(), &page_id, sizeof(page_id));
+        page_ids.emplace_back(page_id);
+    }
+
+    // all the threads read the same small set of pages through a tiny pool, so most fetches either miss or wait for
+    // another thread's read or write-back of the same page
+    std::atomic<size_t> failures = 0;
+    TaskQueue tasks;
+    for (size_t t = 0; t < MISS_THREADS; ++t) {
+        tasks.push([&, t]() {
+            std::mt19937 rng(t);
+            for (size_t i = 0; i < MISS_ROUNDS; ++i) {
+                auto page_id = page_ids[rng() % page_ids.size()];
+                auto page = bm.fetch_page(page_id);
+                if (!page) {
+                    continue;
+                }
+                std::shared_lock latch(page->rwlatch());
+                if (std::memcmp(page->data(), &page_id, sizeof(page_id)) != 0) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    tasks.wait();
+    TEST_ASSERT_EQ(failures.load(), 0);
+
+    // every frame should be unpinned again
+    for (size_t i = 0; i < MISS_POOL_SIZE; ++i) {
+        auto page = bm.new_page();
+        TEST_ASSERT_NE(page, std::nullopt);
+        page_ids[i] = page->page_id();
+    }
+    fmt::print("passed!\n");
+}
+
+void test_resize() {
+    fmt::print("test concurrent fetches during resizes...\n");
+    remove("test.db");
+    io::DiskManager dm("test.db");
+    buffer::BufferManager bm(RESIZE_SIZES[0], &dm, RESIZE_PARTITIONS);
+
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < RESIZE_PAGES; ++i) {
+        auto page = bm.new_page();
+        TEST_ASSERT_NE(page, std::nullopt);
+        auto page_id = page->page_id();
+        std::memcpy(page->data_mut(), &page_id, sizeof(page_id));
+        page_ids.emplace_back(page_id);
+    }
+
+    // the pool keeps growing and shrinking under the readers and writers, so dirty pages are written back both by
+    // evictions and by retiring frames
+    std::atomic<size_t> failures = 0;
+    std::atomic<bool> done = false;
+    TaskQueue tasks;
+    for (size_t t = 0; t < RESIZE_THREADS; ++t) {
+        tasks.push([&, t]() {
+            std::mt19937 rng(t);
+            for (size_t i = 0; i < RESIZE_ROUNDS; ++i) {
+                auto page_id = page_ids[rng() % page_ids.size()];
+                auto page = bm.fetch_page(page_id);
+                if (!page) {
+                    continue;
+                }
+                std::unique_lock latch(page->rwlatch());
+                if (std::memcmp(page->data(), &page_id, sizeof(page_id)) != 0) {
+                    ++failures;
+                }
+                page->data_mut()[PAGE_SIZE - 1] = static_cast<char>(i);
+            }
+        });
+    }
+    std::thread resizer([&]() {
+        for (size_t i = 0; !done.load(); i = (i + 1) % std::size(RESIZE_SIZES)) {
+            bm.resize(RESIZE_SIZES[i]);
+        }
+    });
+    tasks.wait();
+    done.store(true);
+    resizer.join();
+    TEST_ASSERT_EQ(failures.load(), 0);
+
+    // nothing is pinned any more, so the pool can reach any size
+    TEST_ASSERT_EQ(bm.resize(RESIZE_PARTITIONS), RESIZE_PARTITIONS);
+    TEST_ASSERT_EQ(bm.resize(RESIZE_PAGES), RESIZE_PAGES);
+    for (auto page_id : page_ids) {
+        auto page = bm.fetch_page(page_id);
+        TEST_ASSERT_NE(page, std::nullopt);
+        TEST_ASSERT_EQ(std::memcmp(page->data(), &page_id, sizeof(page_id)), 0);
+    }
+    fmt::print("passed!\n");
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<std::pair<std::string_view, std::function<void()>>> test_f{
+        {"hit", test_hit},
+        {"evict", []() { test_evict(buffer::ReplacementPolicy::Lru, false); }},
+        {"evict_clock", []() { test_evict(buffer::ReplacementPolicy::Clock, false); }},
+        {"evict_lru_k", []() { test_evict(buffer::ReplacementPolicy::LruK, false); }},
+        {"evict_background_writer", []() { test_evict(buffer::ReplacementPolicy::Lru, true); }},
+        {"clean", test_clean},
+        {"prefetch", []() { test_prefetch(io::IoBackend::Sync); }},
+        {"prefetch_io_uring", []() { test_prefetch(io::IoBackend::IoUring); }},
+        {"prefetch_after_shrink", test_prefetch_after_shrink},
+        {"miss", test_miss},
+        {"resize", test_resize},
+    };
+    if (argc != 2) {
+        fmt::print("usage: {} <testcase>\n<testcase> can be:\n", argv[0]);
+        for (auto &[name, _] : test_f) {
+            fmt::print("{}\n", name);
+        }
+        return EXIT_FAILURE;
+    }
+    auto testcase = std::string_view(argv[1]);
+    if (testcase == "all") {
+        for (auto &[_, f] : test_f) {
+            f();
+        }
+    } else if (auto iter = std::find_if(test_f.begin(), test_f.end(), [&](auto v) { return v.first == testcase; });
+               iter != test_f.end()) {
+        iter->second();
+    } else {
+        fmt::print("error: invalid testcase!\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
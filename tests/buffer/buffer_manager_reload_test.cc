@@ -0,0 +1,86 @@
+#include "buffer/buffer_manager.h"
+#include "common/constants.h"
+#include "common/types.h"
+#include "io/disk_manager.h"
+#include "storage/page/page_guard.h"
+#include "test_utils.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace naivedb;
+
+constexpr size_t PAGES = 64;
+constexpr size_t PARTITIONS = 2;
+const std::string DUMP_FILE = "test.db.resident";
+
+bool resident(buffer::BufferManager &bm, page_id_t page_id) {
+    auto page = bm.try_fetch_page(page_id);
+    return page && std::memcmp(page->data(), &page_id, sizeof(page_id)) == 0;
+}
+
+int main() {
+    remove("test.db");
+    remove(DUMP_FILE.c_str());
+    io::DiskManager dm("test.db");
+
+    {
+        buffer::BufferManager bm(16, &dm, PARTITIONS);
+        TEST_ASSERT(!bm.start_reload(DUMP_FILE));
+        for (size_t i = 0; i < PAGES; ++i) {
+            auto page = bm.new_page();
+            TEST_ASSERT_NE(page, std::nullopt);
+            auto page_id = page->page_id();
+            std::memcpy(page->data_mut(), &page_id, sizeof(page_id));
+        }
+        bm.flush_all_pages();
+        // pages 48-63 are resident, then pages 0-7 replace pages 48-55 and become the most recently used
+        for (page_id_t page_id = 0; page_id < 8; ++page_id) {
+            TEST_ASSERT_NE(bm.fetch_page(page_id), std::nullopt);
+        }
+        TEST_ASSERT_EQ(bm.dump_resident_pages(DUMP_FILE), 16);
+
+        // the background writer dumps the pages periodically
+        remove(DUMP_FILE.c_str());
+        buffer::BackgroundWriterOptions options;
+        options.interval_ = std::chrono::milliseconds(1);
+        options.resident_pages_file_ = DUMP_FILE;
+        options.dump_interval_ = std::chrono::milliseconds(0);
+        bm.start_background_writer(options);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        bm.stop_background_writer();
+    }
+
+    {
+        // a smaller pool only reloads the most recently used pages
+        buffer::BufferManager bm(8, &dm, PARTITIONS);
+        TEST_ASSERT(bm.start_reload(DUMP_FILE));
+        TEST_ASSERT_EQ(bm.wait_reload(), 8);
+        for (page_id_t page_id = 0; page_id < 8; ++page_id) {
+            TEST_ASSERT(resident(bm, page_id));
+        }
+        TEST_ASSERT(!resident(bm, 63));
+        TEST_ASSERT_EQ(bm.stats().misses_, 0);
+    }
+
+    {
+        // a page fetched before the reload keeps its frame, so one page less is reloaded in its partition
+        buffer::BufferManager bm(8, &dm, PARTITIONS);
+        auto page = bm.fetch_page(63);
+        TEST_ASSERT_NE(page, std::nullopt);
+        TEST_ASSERT(bm.start_reload(DUMP_FILE));
+        TEST_ASSERT_EQ(bm.wait_reload(), 7);
+        TEST_ASSERT(resident(bm, 63));
+        for (page_id_t page_id = 0; page_id < 8; page_id += 2) {
+            TEST_ASSERT(resident(bm, page_id));
+        }
+    }
+
+    remove(DUMP_FILE.c_str());
+    return EXIT_SUCCESS;
+}
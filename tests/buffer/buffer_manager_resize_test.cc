@@ -0,0 +1,84 @@
+#include "buffer/buffer_manager.h"
+#include "common/constants.h"
+#include "common/types.h"
+#include "io/memory_storage.h"
+#include "storage/page/page_guard.h"
+#include "test_utils.h"
+
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <thread>
+#include <vector>
+
+using namespace naivedb;
+
+constexpr size_t PARTITIONS = 2;
+
+bool check_page(buffer::BufferManager &bm, page_id_t page_id) {
+    auto page = bm.fetch_page(page_id);
+    return page && std::memcmp(page->data(), &page_id, sizeof(page_id)) == 0;
+}
+
+int main() {
+    io::MemoryStorage storage;
+    buffer::BufferManager bm(4, &storage, PARTITIONS);
+    TEST_ASSERT_EQ(bm.size(), 4);
+
+    // fill the pool with pinned pages
+    std::vector<storage::PageGuard> pages;
+    std::vector<page_id_t> page_ids;
+    auto new_pages = [&](size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            auto page = bm.new_page();
+            TEST_ASSERT_NE(page, std::nullopt);
+            auto page_id = page->page_id();
+            std::memcpy(page->data_mut(), &page_id, sizeof(page_id));
+            page_ids.emplace_back(page_id);
+            pages.emplace_back(*std::move(page));
+        }
+    };
+    new_pages(4);
+    TEST_ASSERT_EQ(bm.new_page(), std::nullopt);
+
+    // growing gives free frames at once, beyond the first chunk of frames
+    TEST_ASSERT_EQ(bm.resize(200), 200);
+    TEST_ASSERT_EQ(bm.size(), 200);
+    new_pages(196);
+    TEST_ASSERT_EQ(bm.new_page(), std::nullopt);
+
+    // shrinking only retires the unpinned frames
+    pages.resize(20);
+    TEST_ASSERT_EQ(bm.resize(10), 20);
+    TEST_ASSERT_EQ(bm.stats().dirty_evictions_, 180);
+    pages.clear();
+    // the background writer retires the rest
+    bm.start_background_writer({0.25, 64, std::chrono::milliseconds(1)});
+    for (int i = 0; i < 1000 && bm.size() > 10; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    bm.stop_background_writer();
+    TEST_ASSERT_EQ(bm.size(), 10);
+    for (auto page_id : page_ids) {
+        TEST_ASSERT(check_page(bm, page_id));
+    }
+
+    // only 10 pages fit now
+    for (size_t i = 0; i < 10; ++i) {
+        auto page = bm.fetch_page(page_ids[i]);
+        TEST_ASSERT_NE(page, std::nullopt);
+        pages.emplace_back(*std::move(page));
+    }
+    TEST_ASSERT_EQ(bm.fetch_page(page_ids[10]), std::nullopt);
+
+    // growing again reuses the retired frames
+    TEST_ASSERT_EQ(bm.resize(12), 12);
+    for (size_t i = 10; i < 12; ++i) {
+        TEST_ASSERT(check_page(bm, page_ids[i]));
+    }
+    pages.clear();
+    for (auto page_id : page_ids) {
+        TEST_ASSERT(check_page(bm, page_id));
+    }
+    return EXIT_SUCCESS;
+}
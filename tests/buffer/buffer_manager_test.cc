@@ -90,5 +90,14 @@ int main() {
     dm.read_page(page_id[2], buf);
     TEST_ASSERT_EQ(std::memcmp(buf, str[2].data(), str[2].size()), 0);
 
+    for (int i = 0; i < 3; ++i) {
+        storage::PageGuard unpinned = std::move(page[i]);
+    }
+    // a hit marks the page as referenced without moving it in the replacer, which gives it a second chance
+    TEST_ASSERT_NE(bm.fetch_page(page_id[0]), std::nullopt);
+    TEST_ASSERT_NE(bm.new_page(), std::nullopt);
+    TEST_ASSERT_NE(bm.try_fetch_page(page_id[0]), std::nullopt);
+    TEST_ASSERT_EQ(bm.try_fetch_page(page_id[1]), std::nullopt);
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "buffer/buffer_manager.h"
+#include "buffer/buffer_stats.h"
+#include "io/memory_storage.h"
+#include "storage/page/page_guard.h"
+#include "test_utils.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+using namespace naivedb;
+using namespace std::chrono_literals;
+
+void test_histogram() {
+    buffer::LatencyHistogram histogram;
+    TEST_ASSERT_EQ(histogram.percentile(0.5).count(), 0);
+
+    TEST_ASSERT_EQ(buffer::LatencyHistogram::bucket_of(0ns), 0);
+    TEST_ASSERT_EQ(buffer::LatencyHistogram::bucket_of(1ns), 0);
+    TEST_ASSERT_EQ(buffer::LatencyHistogram::bucket_of(2ns), 1);
+    TEST_ASSERT_EQ(buffer::LatencyHistogram::bucket_of(1023ns), 9);
+    TEST_ASSERT_EQ(buffer::LatencyHistogram::bucket_of(1024ns), 10);
+    TEST_ASSERT_EQ(buffer::LatencyHistogram::bucket_of(std::chrono::hours(1000)), buffer::LatencyHistogram::BUCKETS - 1);
+
+    // 90 latencies around 1us and 10 around 1ms
+    histogram.add(buffer::LatencyHistogram::bucket_of(1000ns), 90);
+    histogram.add(buffer::LatencyHistogram::bucket_of(1ms), 10);
+    TEST_ASSERT_EQ(histogram.count(), 100);
+    TEST_ASSERT_EQ(histogram.percentile(0.5).count(), 1024);
+    TEST_ASSERT_EQ(histogram.percentile(0.89).count(), 1024);
+    TEST_ASSERT_EQ(histogram.percentile(0.9).count(), 1 << 20);
+    TEST_ASSERT_EQ(histogram.percentile(0.99).count(), 1 << 20);
+}
+
+void test_counters() {
+    constexpr size_t POOL_SIZE = 4;
+    constexpr size_t NUM_PAGES = 8;
+    io::MemoryStorage storage;
+    buffer::BufferManager bm(POOL_SIZE, &storage, 1);
+
+    for (size_t i = 0; i < NUM_PAGES; ++i) {
+        storage.alloc_page();
+    }
+
+    // the first pass misses on every page and has to evict once the pool is full
+    for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(NUM_PAGES); ++page_id) {
+        auto page = bm.fetch_page(page_id);
+        TEST_ASSERT(page.has_value());
+        if (page_id % 2 == 0) {
+            std::memset(page->data_mut(), 1, 8);
+        }
+    }
+    auto stats = bm.stats();
+    TEST_ASSERT_EQ(stats.hits_, 0);
+    TEST_ASSERT_EQ(stats.misses_, NUM_PAGES);
+    TEST_ASSERT_EQ(stats.evictions_, NUM_PAGES - POOL_SIZE);
+    TEST_ASSERT_EQ(stats.dirty_evictions_, (NUM_PAGES - POOL_SIZE) / 2);
+    TEST_ASSERT_EQ(stats.miss_latency_.count(), NUM_PAGES);
+    TEST_ASSERT_EQ(stats.victim_latency_.count(), NUM_PAGES);
+
+    // the last pages are still resident
+    for (page_id_t page_id = NUM_PAGES - POOL_SIZE; page_id < static_cast<page_id_t>(NUM_PAGES); ++page_id) {
+        TEST_ASSERT(bm.fetch_page(page_id).has_value());
+    }
+    // probes are not accesses, so they do not count as hits
+    TEST_ASSERT(bm.try_fetch_page(NUM_PAGES - 1).has_value());
+    TEST_ASSERT(!bm.try_fetch_page(0).has_value());
+    stats = bm.stats();
+    TEST_ASSERT_EQ(stats.hits_, POOL_SIZE);
+    TEST_ASSERT_EQ(stats.probes_, 1);
+    TEST_ASSERT_EQ(stats.misses_, NUM_PAGES);
+    TEST_ASSERT_EQ(stats.evictions_, NUM_PAGES - POOL_SIZE);
+    TEST_ASSERT(stats.hit_ratio() > 0.3 && stats.hit_ratio() < 0.4);
+    std::cout << fmt::format("{}", stats) << std::endl;
+}
+
+int main() {
+    test_histogram();
+    test_counters();
+}
@@ -0,0 +1,97 @@
+#include "buffer/clock_replacer.h"
+#include "common/constants.h"
+#include "test_utils.h"
+
+#include <vector>
+
+using namespace naivedb;
+
+int main() {
+    {
+        buffer::ClockReplacer replacer(7);
+
+        replacer.unpin(1);
+        replacer.unpin(2);
+        replacer.unpin(3);
+        replacer.unpin(4);
+        replacer.unpin(5);
+        replacer.unpin(6);
+        replacer.unpin(1);
+        TEST_ASSERT_EQ(replacer.size(), 6);
+
+        auto victim = replacer.victim();
+        TEST_ASSERT_EQ(victim, 1);
+        victim = replacer.victim();
+        TEST_ASSERT_EQ(victim, 2);
+        victim = replacer.victim();
+        TEST_ASSERT_EQ(victim, 3);
+
+        replacer.pin(3);
+        replacer.pin(4);
+        TEST_ASSERT_EQ(replacer.size(), 2);
+
+        replacer.unpin(4);
+        victim = replacer.victim();
+        TEST_ASSERT_EQ(victim, 5);
+        victim = replacer.victim();
+        TEST_ASSERT_EQ(victim, 6);
+        victim = replacer.victim();
+        TEST_ASSERT_EQ(victim, 4);
+        victim = replacer.victim();
+        TEST_ASSERT_EQ(victim, naivedb::INVALID_FRAME_ID);
+    }
+
+    {
+        // frame ids starting from an offset, and the second chance of a referenced frame
+        buffer::ClockReplacer replacer(3, 10);
+
+        replacer.unpin(10);
+        replacer.unpin(11);
+        replacer.unpin(12);
+        TEST_ASSERT_EQ(replacer.victim(), 10);
+
+        replacer.unpin(10);
+        TEST_ASSERT_EQ(replacer.size(), 3);
+        TEST_ASSERT_EQ(replacer.victim(), 11);
+        TEST_ASSERT_EQ(replacer.victim(), 12);
+        TEST_ASSERT_EQ(replacer.victim(), 10);
+        TEST_ASSERT_EQ(replacer.size(), 0);
+    }
+
+    {
+        // every fourth frame id starting from 2, and frames added beyond the initial range
+        buffer::ClockReplacer replacer(2, 2, 4);
+
+        replacer.unpin(2);
+        replacer.unpin(6);
+        replacer.unpin(14);
+        TEST_ASSERT_EQ(replacer.size(), 3);
+        replacer.pin(6);
+        replacer.pin(18);
+        TEST_ASSERT_EQ(replacer.size(), 2);
+        TEST_ASSERT_EQ(replacer.victim(), 2);
+        TEST_ASSERT_EQ(replacer.victim(), 14);
+        TEST_ASSERT_EQ(replacer.victim(), INVALID_FRAME_ID);
+    }
+
+    {
+        // a restored frame is not given a second chance
+        buffer::ClockReplacer replacer(3);
+
+        replacer.unpin(0);
+        replacer.unpin(1);
+        replacer.unpin(2);
+        TEST_ASSERT_EQ(replacer.victim(), 0);
+        replacer.unpin(1);
+        replacer.unpin(2);
+        replacer.restore(0);
+        TEST_ASSERT_EQ(replacer.size(), 3);
+        TEST_ASSERT_EQ(replacer.candidates(1), (std::vector<frame_id_t>{0}));
+        TEST_ASSERT_EQ(replacer.victim(), 0);
+        replacer.restore(0);
+        replacer.restore(0);
+        TEST_ASSERT_EQ(replacer.size(), 3);
+    }
+
+    return EXIT_SUCCESS;
+}
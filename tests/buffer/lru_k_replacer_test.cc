@@ -0,0 +1,99 @@
+#include "buffer/lru_k_replacer.h"
+#include "common/constants.h"
+#include "test_utils.h"
+
+using namespace naivedb;
+
+int main() {
+    {
+        buffer::LruKReplacer replacer(2, 0);
+
+        // frames accessed fewer than K times are evicted first, in LRU order
+        replacer.unpin(1);
+        replacer.unpin(2);
+        replacer.unpin(3);
+        replacer.unpin(1);
+        TEST_ASSERT_EQ(replacer.size(), 3);
+        TEST_ASSERT_EQ(replacer.victim(), 2);
+        TEST_ASSERT_EQ(replacer.victim(), 3);
+        TEST_ASSERT_EQ(replacer.victim(), 1);
+        TEST_ASSERT_EQ(replacer.victim(), naivedb::INVALID_FRAME_ID);
+
+        // the frame whose K-th most recent access is the oldest is evicted first
+        replacer.unpin(1);
+        replacer.unpin(2);
+        replacer.unpin(1);
+        replacer.unpin(2);
+        replacer.unpin(3);
+        replacer.unpin(3);
+        replacer.pin(2);
+        TEST_ASSERT_EQ(replacer.size(), 2);
+        TEST_ASSERT_EQ(replacer.victim(), 1);
+        TEST_ASSERT_EQ(replacer.victim(), 3);
+        TEST_ASSERT_EQ(replacer.victim(), naivedb::INVALID_FRAME_ID);
+
+        // pinned frames keep their history
+        replacer.unpin(4);
+        replacer.unpin(2);
+        TEST_ASSERT_EQ(replacer.victim(), 4);
+        TEST_ASSERT_EQ(replacer.victim(), 2);
+    }
+
+    {
+        buffer::LruKReplacer replacer(2, 2);
+
+        // the second access of frame 1 is correlated with the first one, so frame 1 is accessed only once
+        replacer.unpin(1);
+        replacer.unpin(1);
+        replacer.unpin(2);
+        replacer.unpin(3);
+        replacer.unpin(2);
+        TEST_ASSERT_EQ(replacer.victim(), 1);
+        // all the remaining frames are within their correlated reference periods, so the usual order applies
+        TEST_ASSERT_EQ(replacer.victim(), 3);
+        TEST_ASSERT_EQ(replacer.victim(), 2);
+    }
+
+    {
+        buffer::LruKReplacer replacer(2, 2);
+
+        replacer.unpin(2);
+        replacer.unpin(3);
+        replacer.unpin(2);
+        replacer.unpin(5);
+        TEST_ASSERT_EQ(replacer.victim(), 3);
+        replacer.unpin(6);
+        replacer.pin(6);
+        // frame 5 has an infinite backward K-distance, but it is still within its correlated reference period
+        TEST_ASSERT_EQ(replacer.victim(), 2);
+        TEST_ASSERT_EQ(replacer.victim(), 5);
+    }
+
+    {
+        buffer::LruKReplacer replacer(2, 0);
+
+        // a victim that cannot be evicted is put back with its history, without counting an access
+        replacer.unpin(2);
+        replacer.unpin(2);
+        replacer.unpin(1);
+        replacer.unpin(1);
+        replacer.unpin(3);
+        TEST_ASSERT_EQ(replacer.victim(), 3);
+        TEST_ASSERT_EQ(replacer.victim(), 2);
+        replacer.restore(2);
+        replacer.restore(3);
+        TEST_ASSERT_EQ(replacer.size(), 3);
+        TEST_ASSERT_EQ(replacer.victim(), 3);
+        TEST_ASSERT_EQ(replacer.victim(), 2);
+        TEST_ASSERT_EQ(replacer.victim(), 1);
+
+        // a frame that holds another page forgets the history of the old one
+        replacer.remove(1);
+        replacer.restore(2);
+        replacer.unpin(1);
+        TEST_ASSERT_EQ(replacer.victim(), 1);
+        TEST_ASSERT_EQ(replacer.victim(), 2);
+    }
+
+    return EXIT_SUCCESS;
+}
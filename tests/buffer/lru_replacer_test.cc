@@ -2,6 +2,8 @@
 #include "common/constants.h"
 #include "test_utils.h"
 
+#include <vector>
+
 using namespace naivedb;
 
 int main() {
@@ -37,5 +39,40 @@ int main() {
     victim = replacer.victim();
     TEST_ASSERT_EQ(victim, naivedb::INVALID_FRAME_ID);
 
+    {
+        // every fourth frame id starting from 1, as in a partition of a buffer pool with 4 partitions
+        buffer::LruReplacer strided(2, 1, 4);
+        strided.unpin(9);
+        strided.unpin(1);
+        strided.unpin(5);
+        TEST_ASSERT_EQ(strided.size(), 3);
+        TEST_ASSERT_EQ(strided.candidates(3), (std::vector<naivedb::frame_id_t>{9, 1, 5}));
+        strided.pin(1);
+        TEST_ASSERT_EQ(strided.victim(), 9);
+        TEST_ASSERT_EQ(strided.victim(), 5);
+        TEST_ASSERT_EQ(strided.victim(), naivedb::INVALID_FRAME_ID);
+    }
+
+    {
+        // a restored frame goes back to the least recently used end
+        buffer::LruReplacer restored;
+        restored.unpin(1);
+        restored.unpin(2);
+        restored.unpin(3);
+        TEST_ASSERT_EQ(restored.victim(), 1);
+        restored.restore(1);
+        restored.restore(1);
+        TEST_ASSERT_EQ(restored.size(), 3);
+        TEST_ASSERT_EQ(restored.candidates(3), (std::vector<naivedb::frame_id_t>{1, 2, 3}));
+        TEST_ASSERT_EQ(restored.victim(), 1);
+        TEST_ASSERT_EQ(restored.victim(), 2);
+        restored.restore(2);
+        TEST_ASSERT_EQ(restored.victim(), 2);
+        TEST_ASSERT_EQ(restored.victim(), 3);
+        restored.restore(3);
+        TEST_ASSERT_EQ(restored.victim(), 3);
+        TEST_ASSERT_EQ(restored.victim(), naivedb::INVALID_FRAME_ID);
+    }
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "catalog/table_info.h"
 #include "common/constants.h"
 #include "io/disk_manager.h"
+#include "storage/page/page_guard.h"
 #include "test_utils.h"
 #include "type/type.h"
 #include "type/type_id.h"
@@ -38,5 +39,15 @@ int main() {
                        {"col_2", type::Type(type::Char(3))},
                    }));
 
+    // a table with a pinned page is kept until the drop succeeds
+    {
+        auto root_page = bm.fetch_page(table_info.root_page_id());
+        TEST_ASSERT(root_page.has_value());
+        TEST_ASSERT(!catalog.drop_table(table_id));
+        TEST_ASSERT_EQ(catalog.get_table_id("tab_1"), table_id);
+    }
+    TEST_ASSERT(catalog.drop_table(table_id));
+    TEST_ASSERT_EQ(catalog.get_table_id("tab_1"), INVALID_TABLE_ID);
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
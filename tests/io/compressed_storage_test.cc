@@ -0,0 +1,230 @@
+#include "buffer/buffer_manager.h"
+#include "common/constants.h"
+#include "common/exception.h"
+#include "common/types.h"
+#include "io/compressed_storage.h"
+#include "io/page_codec.h"
+#include "storage/page/page_guard.h"
+#include "test_utils.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <random>
+#include <sys/stat.h>
+#include <vector>
+
+using namespace naivedb;
+
+constexpr size_t PAGES = 64;
+
+size_t file_size(const char *file_name) {
+    struct stat buf;
+    TEST_ASSERT_EQ(stat(file_name, &buf), 0);
+    return buf.st_size;
+}
+
+void remove_files() {
+    remove("test.db");
+    remove("test.db.map");
+}
+
+/**
+ * @brief Fill a page like a table page: rows of a small integer followed by a short string padded with zeros.
+ *
+ */
+void fill_table_page(char *page, std::mt19937 &rng) {
+    std::memset(page, 0, PAGE_SIZE);
+    for (size_t offset = 0; offset + 64 <= PAGE_SIZE; offset += 64) {
+        auto value = static_cast<int32_t>(rng() % 100);
+        std::memcpy(page + offset, &value, sizeof(value));
+        for (size_t i = 0; i < rng() % 12; ++i) {
+            page[offset + 4 + i] = static_cast<char>('a' + rng() % 26);
+        }
+    }
+}
+
+void fill_random_page(char *page, std::mt19937 &rng) {
+    for (size_t i = 0; i < PAGE_SIZE; ++i) {
+        page[i] = static_cast<char>(rng());
+    }
+}
+
+/**
+ * @brief Compressed blocks decompress to the original, and corrupted blocks are rejected.
+ *
+ */
+void test_codec() {
+    std::mt19937 rng(0);
+    char page[PAGE_SIZE], compressed[2 * PAGE_SIZE], decompressed[PAGE_SIZE];
+    for (int kind = 0; kind < 3; ++kind) {
+        if (kind == 0) {
+            std::memset(page, 7, PAGE_SIZE);
+        } else if (kind == 1) {
+            fill_table_page(page, rng);
+        } else {
+            fill_random_page(page, rng);
+        }
+        auto size = io::compress_block(page, PAGE_SIZE, compressed, sizeof(compressed));
+        TEST_ASSERT(size > 0);
+        if (kind < 2) {
+            TEST_ASSERT(size < PAGE_SIZE / 2);
+        }
+        TEST_ASSERT(io::decompress_block(compressed, size, decompressed, PAGE_SIZE));
+        TEST_ASSERT_EQ(std::memcmp(page, decompressed, PAGE_SIZE), 0);
+        // too little room for the output
+        TEST_ASSERT_EQ(io::compress_block(page, PAGE_SIZE, compressed, size - 1), 0);
+        // a truncated block, or one decompressing to a different size
+        TEST_ASSERT(!io::decompress_block(compressed, size - 1, decompressed, PAGE_SIZE));
+        TEST_ASSERT(!io::decompress_block(compressed, size, decompressed, PAGE_SIZE - 1));
+    }
+    // random garbage must not crash the decoder
+    for (int i = 0; i < 1000; ++i) {
+        fill_random_page(compressed, rng);
+        io::decompress_block(compressed, rng() % PAGE_SIZE, decompressed, PAGE_SIZE);
+    }
+}
+
+/**
+ * @brief Pages of all kinds read back the same, also after they are overwritten and after reopening the files, and
+ * compressible pages take less space.
+ *
+ */
+void test_pages() {
+    remove_files();
+    std::mt19937 rng(0);
+    std::vector<std::vector<char>> pages(PAGES, std::vector<char>(PAGE_SIZE));
+    std::vector<page_id_t> page_ids;
+    char buf[PAGE_SIZE];
+    {
+        io::CompressedStorage storage("test.db");
+        for (size_t i = 0; i < PAGES; ++i) {
+            page_ids.emplace_back(storage.alloc_page());
+            TEST_ASSERT_EQ(page_ids.back(), static_cast<page_id_t>(i));
+            // allocated pages read as zeros and take no space
+            storage.read_page(page_ids.back(), buf);
+            TEST_ASSERT_EQ(buf[0], 0);
+            fill_table_page(pages[i].data(), rng);
+            storage.write_page(page_ids[i], pages[i].data());
+        }
+        TEST_ASSERT(storage.stored_bytes() < PAGES * PAGE_SIZE / 2);
+        // overwrite some pages with incompressible and empty data
+        for (size_t i = 0; i < PAGES; i += 4) {
+            fill_random_page(pages[i].data(), rng);
+            storage.write_page(page_ids[i], pages[i].data());
+            std::memset(pages[i + 1].data(), 0, PAGE_SIZE);
+            storage.write_page(page_ids[i + 1], pages[i + 1].data());
+        }
+        for (size_t i = 0; i < PAGES; ++i) {
+            storage.read_page(page_ids[i], buf);
+            TEST_ASSERT_EQ(std::memcmp(buf, pages[i].data(), PAGE_SIZE), 0);
+        }
+        storage.free_page(page_ids[PAGES - 1]);
+        bool failed = false;
+        try {
+            storage.read_page(page_ids[PAGES - 1], buf);
+        } catch (const IOException &) {
+            failed = true;
+        }
+        TEST_ASSERT(failed);
+    }
+
+    io::CompressedStorage storage("test.db");
+    TEST_ASSERT(!storage.page_allocated(page_ids[PAGES - 1]));
+    for (size_t i = 0; i + 1 < PAGES; ++i) {
+        TEST_ASSERT(storage.page_allocated(page_ids[i]));
+        storage.read_page(page_ids[i], buf);
+        TEST_ASSERT_EQ(std::memcmp(buf, pages[i].data(), PAGE_SIZE), 0);
+    }
+    // the free space left by the overwritten pages is found again and reused
+    auto size = file_size("test.db");
+    for (size_t i = 2; i < PAGES; i += 4) {
+        fill_table_page(pages[i].data(), rng);
+        storage.write_page(page_ids[i], pages[i].data());
+    }
+    TEST_ASSERT_EQ(file_size("test.db"), size);
+    TEST_ASSERT_EQ(storage.alloc_page(), page_ids[PAGES - 1]);
+
+    // free the pages stored at the end of the file
+    for (size_t i = PAGES / 2; i < PAGES; ++i) {
+        storage.free_page(page_ids[i]);
+    }
+    TEST_ASSERT(storage.truncate_free_tail() > 0);
+    TEST_ASSERT(file_size("test.db") <= storage.stored_bytes() + PAGES * PAGE_SIZE / 2);
+    for (size_t i = 0; i < PAGES / 2; ++i) {
+        storage.read_page(page_ids[i], buf);
+        TEST_ASSERT_EQ(std::memcmp(buf, pages[i].data(), PAGE_SIZE), 0);
+    }
+    remove_files();
+}
+
+/**
+ * @brief The slots freed next to each other are merged, so a page needing more units than any of them fits in.
+ *
+ */
+void test_coalesce() {
+    remove_files();
+    std::mt19937 rng(0);
+    char page[PAGE_SIZE] = {1};
+    io::CompressedStorage storage("test.db");
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < 8; ++i) {
+        page_ids.emplace_back(storage.alloc_page());
+        storage.write_page(page_ids.back(), page);
+    }
+    // the last small page keeps the others away from the end of the file
+    auto fence_page_id = storage.alloc_page();
+    storage.write_page(fence_page_id, page);
+    TEST_ASSERT_EQ(file_size("test.db"), 9 * 512);
+    for (auto page_id : page_ids) {
+        storage.free_page(page_id);
+    }
+    auto page_id = storage.alloc_page();
+    fill_random_page(page, rng);
+    storage.write_page(page_id, page);
+    TEST_ASSERT_EQ(file_size("test.db"), 9 * 512);
+
+    char buf[PAGE_SIZE];
+    storage.read_page(page_id, buf);
+    TEST_ASSERT_EQ(std::memcmp(buf, page, PAGE_SIZE), 0);
+    remove_files();
+}
+
+/**
+ * @brief Buffer frames see plain pages on top of compressed storage.
+ *
+ */
+void test_buffer_manager() {
+    remove_files();
+    std::mt19937 rng(0);
+    std::vector<std::vector<char>> pages(PAGES, std::vector<char>(PAGE_SIZE));
+    std::vector<page_id_t> page_ids;
+    {
+        io::CompressedStorage storage("test.db");
+        buffer::BufferManager bm(4, &storage);
+        for (size_t i = 0; i < PAGES; ++i) {
+            auto page = bm.new_page();
+            TEST_ASSERT_NE(page, std::nullopt);
+            fill_table_page(pages[i].data(), rng);
+            std::memcpy(page->data_mut(), pages[i].data(), PAGE_SIZE);
+            page_ids.emplace_back(page->page_id());
+        }
+        bm.flush_all_pages();
+    }
+    io::CompressedStorage storage("test.db");
+    buffer::BufferManager bm(4, &storage);
+    for (size_t i = 0; i < PAGES; ++i) {
+        auto page = bm.fetch_page(page_ids[i]);
+        TEST_ASSERT_NE(page, std::nullopt);
+        TEST_ASSERT_EQ(std::memcmp(page->data(), pages[i].data(), PAGE_SIZE), 0);
+    }
+    remove_files();
+}
+
+int main() {
+    test_codec();
+    test_pages();
+    test_coalesce();
+    test_buffer_manager();
+    return EXIT_SUCCESS;
+}
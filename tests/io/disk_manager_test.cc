@@ -1,12 +1,299 @@
 #include "common/constants.h"
+#include "common/exception.h"
 #include "common/types.h"
 #include "io/disk_manager.h"
 #include "test_utils.h"
 
+#include <atomic>
+#include <cstdlib>
 #include <cstring>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
 
 using namespace naivedb;
 
+constexpr size_t BATCH_PAGES = 16;
+constexpr size_t CONCURRENT_PAGES = 64;
+constexpr page_id_t ALLOC_PAGES = 200;
+// a page far beyond the end of the small files of the tests, including their preallocated space
+constexpr page_id_t PAGE_PAST_EOF = 30000;
+constexpr size_t THREADS = 8;
+constexpr size_t READS_PER_THREAD = 1000;
+
+/**
+ * @brief Write and read a batch of pages with submit() and wait().
+ *
+ */
+void test_batch(io::IoBackend backend) {
+    remove("test.db");
+    io::DiskManager dm("test.db", backend);
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < BATCH_PAGES; ++i) {
+        page_ids.emplace_back(dm.alloc_page());
+    }
+
+    auto buf = static_cast<char *>(std::aligned_alloc(PAGE_SIZE, BATCH_PAGES * PAGE_SIZE));
+    std::vector<io::DiskManager::IoRequest> requests;
+    for (size_t i = 0; i < BATCH_PAGES; ++i) {
+        std::memset(buf + i * PAGE_SIZE, static_cast<int>(i + 1), PAGE_SIZE);
+        requests.push_back({page_ids[i], buf + i * PAGE_SIZE, true, false});
+    }
+    dm.wait(dm.submit(requests.data(), requests.size()));
+    for (auto &request : requests) {
+        TEST_ASSERT(request.succeeded_);
+    }
+
+    std::memset(buf, 0, BATCH_PAGES * PAGE_SIZE);
+    // read the pages in reverse order, together with a page past the end of the file
+    requests.clear();
+    for (size_t i = 0; i < BATCH_PAGES; ++i) {
+        requests.push_back({page_ids[BATCH_PAGES - 1 - i], buf + i * PAGE_SIZE, false, false});
+    }
+    alignas(PAGE_SIZE) char unallocated_buf[PAGE_SIZE];
+    requests.push_back({PAGE_PAST_EOF, unallocated_buf, false, true});
+    dm.wait(dm.submit(requests.data(), requests.size()));
+    for (size_t i = 0; i < BATCH_PAGES; ++i) {
+        TEST_ASSERT(requests[i].succeeded_);
+        TEST_ASSERT_EQ(buf[i * PAGE_SIZE], static_cast<char>(BATCH_PAGES - i));
+        TEST_ASSERT_EQ(buf[(i + 1) * PAGE_SIZE - 1], static_cast<char>(BATCH_PAGES - i));
+    }
+    TEST_ASSERT(!requests.back().succeeded_);
+
+    // the synchronous entry points see the same data
+    char page[PAGE_SIZE];
+    dm.read_page(page_ids[0], page);
+    TEST_ASSERT_EQ(page[0], 1);
+    std::free(buf);
+    remove("test.db");
+}
+
+/**
+ * @brief Freed pages are reused lowest first, both before and after reopening the file.
+ *
+ */
+void test_alloc_reuse() {
+    remove("test.db");
+    {
+        io::DiskManager dm("test.db");
+        for (page_id_t i = 0; i < ALLOC_PAGES; ++i) {
+            TEST_ASSERT_EQ(dm.alloc_page(), i);
+        }
+        for (page_id_t page_id : {130, 5, 70, 63, 64}) {
+            dm.free_page(page_id);
+        }
+        for (page_id_t page_id : {5, 63, 64}) {
+            TEST_ASSERT_EQ(dm.lowest_free_page_id(), page_id);
+            TEST_ASSERT_EQ(dm.alloc_page(), page_id);
+        }
+    }
+    io::DiskManager dm("test.db");
+    for (page_id_t page_id : {page_id_t(70), page_id_t(130), ALLOC_PAGES}) {
+        TEST_ASSERT_EQ(dm.alloc_page(), page_id);
+    }
+    remove("test.db");
+}
+
+/**
+ * @brief Allocate runs of pages, which fill the holes left by freed pages if they fit and read as zeros.
+ *
+ */
+void test_alloc_run() {
+    remove("test.db");
+    char buf[PAGE_SIZE];
+    {
+        io::DiskManager dm("test.db");
+        for (page_id_t i = 0; i < 10; ++i) {
+            TEST_ASSERT_EQ(dm.alloc_page(), i);
+        }
+        std::memset(buf, 0xff, PAGE_SIZE);
+        for (page_id_t page_id : {3, 4, 7}) {
+            dm.write_page(page_id, buf);
+            dm.free_page(page_id);
+        }
+        // the hole at page 7 is too small
+        TEST_ASSERT_EQ(dm.alloc_pages(2), 3);
+        TEST_ASSERT_EQ(dm.alloc_pages(300), 10);
+        for (page_id_t page_id : {3, 4, 10, 309}) {
+            dm.read_page(page_id, buf);
+            TEST_ASSERT_EQ(buf[0], 0);
+            TEST_ASSERT_EQ(buf[PAGE_SIZE - 1], 0);
+        }
+    }
+    io::DiskManager dm("test.db");
+    TEST_ASSERT(dm.page_allocated(309));
+    TEST_ASSERT(!dm.page_allocated(310));
+    TEST_ASSERT_EQ(dm.alloc_page(), 7);
+    TEST_ASSERT_EQ(dm.alloc_page(), 310);
+    remove("test.db");
+}
+
+size_t file_size(const char *file_name) {
+    struct stat buf;
+    TEST_ASSERT_EQ(stat(file_name, &buf), 0);
+    return buf.st_size;
+}
+
+/**
+ * @brief Free the pages at the end of the file and truncate it. Freed pages read as zeros once they are reallocated.
+ *
+ */
+void test_truncate_free_tail() {
+    remove("test.db");
+    char buf[PAGE_SIZE];
+    {
+        io::DiskManager dm("test.db");
+        TEST_ASSERT_EQ(dm.alloc_pages(300), 0);
+        std::memset(buf, 0xff, PAGE_SIZE);
+        dm.write_page(5, buf);
+        dm.free_page(5);
+        for (page_id_t page_id = 100; page_id < 300; ++page_id) {
+            dm.free_page(page_id);
+        }
+        auto size = file_size("test.db");
+        // page 99 is the last allocated page, and data page i is at offset (i + 2) * PAGE_SIZE in the first header page
+        constexpr size_t END = (99 + 3) * PAGE_SIZE;
+        TEST_ASSERT_EQ(dm.truncate_free_tail(), size - END);
+        TEST_ASSERT_EQ(file_size("test.db"), END);
+        TEST_ASSERT_EQ(dm.truncate_free_tail(), 0);
+        TEST_ASSERT_EQ(dm.alloc_page(), 5);
+        TEST_ASSERT_EQ(dm.alloc_page(), 100);
+        for (page_id_t page_id : {5, 100}) {
+            dm.read_page(page_id, buf);
+            TEST_ASSERT_EQ(buf[0], 0);
+            TEST_ASSERT_EQ(buf[PAGE_SIZE - 1], 0);
+        }
+        dm.free_page(100);
+    }
+    io::DiskManager dm("test.db");
+    TEST_ASSERT(dm.page_allocated(99));
+    TEST_ASSERT(!dm.page_allocated(100));
+    dm.read_page(99, buf);
+    TEST_ASSERT_EQ(dm.alloc_page(), 100);
+    remove("test.db");
+}
+
+/**
+ * @brief Use pages managed by the second header page, whose bitmap is only read after reopening the file when it is
+ * accessed.
+ *
+ */
+void test_second_header() {
+    constexpr page_id_t PAGES_PER_HEADER = 32768;
+    remove("test.db");
+    char buf[PAGE_SIZE];
+    {
+        io::DiskManager dm("test.db");
+        TEST_ASSERT_EQ(dm.alloc_pages(PAGES_PER_HEADER), 0);
+        TEST_ASSERT_EQ(dm.alloc_page(), PAGES_PER_HEADER);
+        TEST_ASSERT_EQ(dm.alloc_page(), PAGES_PER_HEADER + 1);
+        // the last page of the first header page and the first page of the second one are not adjacent in the file
+        alignas(PAGE_SIZE) char pages[2][PAGE_SIZE];
+        std::memset(pages[0], 1, PAGE_SIZE);
+        std::memset(pages[1], 2, PAGE_SIZE);
+        dm.write_pages({PAGES_PER_HEADER - 1, PAGES_PER_HEADER}, {pages[0], pages[1]});
+        dm.free_page(PAGES_PER_HEADER - 1);
+    }
+    io::DiskManager dm("test.db");
+    TEST_ASSERT(dm.page_allocated(PAGES_PER_HEADER + 1));
+    TEST_ASSERT(!dm.page_allocated(PAGES_PER_HEADER + 2));
+    dm.read_page(PAGES_PER_HEADER, buf);
+    TEST_ASSERT_EQ(buf[0], 2);
+    TEST_ASSERT_EQ(dm.lowest_free_page_id(), PAGES_PER_HEADER - 1);
+    TEST_ASSERT_EQ(dm.alloc_page(), PAGES_PER_HEADER - 1);
+    TEST_ASSERT_EQ(dm.lowest_free_page_id(), PAGES_PER_HEADER + 2);
+    TEST_ASSERT_EQ(dm.alloc_page(), PAGES_PER_HEADER + 2);
+    remove("test.db");
+}
+
+/**
+ * @brief Write and read batches of pages with write_pages() and read_pages(), in an order unrelated to their position.
+ *
+ */
+void test_vectored() {
+    remove("test.db");
+    io::DiskManager dm("test.db");
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < BATCH_PAGES; ++i) {
+        page_ids.emplace_back(dm.alloc_page());
+    }
+
+    auto buf = static_cast<char *>(std::aligned_alloc(PAGE_SIZE, BATCH_PAGES * PAGE_SIZE));
+    // every third page is left out, so that the batch has several runs of adjacent pages
+    std::vector<page_id_t> written_page_ids;
+    std::vector<const char *> written_pages_data;
+    for (size_t i = BATCH_PAGES; i-- > 0;) {
+        if (i % 3 == 2) {
+            continue;
+        }
+        std::memset(buf + i * PAGE_SIZE, static_cast<int>(i + 1), PAGE_SIZE);
+        written_page_ids.emplace_back(page_ids[i]);
+        written_pages_data.emplace_back(buf + i * PAGE_SIZE);
+    }
+    dm.write_pages(written_page_ids, written_pages_data);
+
+    std::memset(buf, 0xff, BATCH_PAGES * PAGE_SIZE);
+    std::vector<char *> pages_data;
+    for (size_t i = 0; i < BATCH_PAGES; ++i) {
+        pages_data.emplace_back(buf + i * PAGE_SIZE);
+    }
+    dm.read_pages(page_ids, pages_data);
+    for (size_t i = 0; i < BATCH_PAGES; ++i) {
+        char expected = i % 3 == 2 ? 0 : static_cast<char>(i + 1);
+        TEST_ASSERT_EQ(buf[i * PAGE_SIZE], expected);
+        TEST_ASSERT_EQ(buf[(i + 1) * PAGE_SIZE - 1], expected);
+    }
+
+    // reading past the end of the file fails
+    bool failed = false;
+    try {
+        dm.read_pages({PAGE_PAST_EOF}, {buf});
+    } catch (const IOException &) {
+        failed = true;
+    }
+    TEST_ASSERT(failed);
+    std::free(buf);
+    remove("test.db");
+}
+
+/**
+ * @brief Read pages from many threads at once, which must not mix up their file positions.
+ *
+ */
+void test_concurrent_reads() {
+    remove("test.db");
+    io::DiskManager dm("test.db");
+    std::vector<page_id_t> page_ids;
+    char buf[PAGE_SIZE];
+    for (size_t i = 0; i < CONCURRENT_PAGES; ++i) {
+        auto page_id = dm.alloc_page();
+        std::memset(buf, 0, PAGE_SIZE);
+        std::memcpy(buf, &page_id, sizeof(page_id));
+        dm.write_page(page_id, buf);
+        page_ids.emplace_back(page_id);
+    }
+
+    std::atomic<size_t> failures = 0;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t]() {
+            char page[PAGE_SIZE];
+            for (size_t i = 0; i < READS_PER_THREAD; ++i) {
+                auto page_id = page_ids[(i * 7 + t) % CONCURRENT_PAGES];
+                dm.read_page(page_id, page);
+                if (std::memcmp(page, &page_id, sizeof(page_id)) != 0) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    TEST_ASSERT_EQ(failures.load(), 0);
+    remove("test.db");
+}
+
 int main() {
     char data1[PAGE_SIZE] = "hello, world!";
     char data2[PAGE_SIZE] = "hello, naivedb!";
@@ -45,8 +332,28 @@ int main() {
         dm.read_page(page2, buf);
         TEST_ASSERT_EQ(std::memcmp(data2, buf, strlen(data2) + 1), 0);
 
+        // aligned memory is read and written directly
+        alignas(PAGE_SIZE) char aligned_buf[PAGE_SIZE];
+        dm.read_page_aligned(page2, aligned_buf);
+        TEST_ASSERT_EQ(std::memcmp(data2, aligned_buf, PAGE_SIZE), 0);
+        std::memcpy(aligned_buf, data1, PAGE_SIZE);
+        dm.write_page_aligned(page2, aligned_buf);
+        dm.read_page(page2, buf);
+        TEST_ASSERT_EQ(std::memcmp(data1, buf, PAGE_SIZE), 0);
+
         page2 = dm.alloc_page();
         TEST_ASSERT_EQ(page1, page2);
     }
+
+    TEST_ASSERT_EQ(io::DiskManager("test.db").backend(), io::IoBackend::Sync);
+    test_batch(io::IoBackend::Sync);
+    // the io_uring backend falls back to the synchronous one on kernels without io_uring
+    test_batch(io::IoBackend::IoUring);
+    test_alloc_reuse();
+    test_alloc_run();
+    test_second_header();
+    test_truncate_free_tail();
+    test_vectored();
+    test_concurrent_reads();
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,133 @@
+#include "buffer/buffer_manager.h"
+#include "common/constants.h"
+#include "common/exception.h"
+#include "common/types.h"
+#include "io/memory_storage.h"
+#include "storage/page/page_guard.h"
+#include "test_utils.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+using namespace naivedb;
+
+constexpr size_t BATCH_PAGES = 16;
+constexpr page_id_t UNALLOCATED_PAGE_ID = 1000;
+
+/**
+ * @brief Allocate, write, read and free pages, one by one and in batches.
+ *
+ */
+void test_pages() {
+    io::MemoryStorage storage;
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < BATCH_PAGES; ++i) {
+        page_ids.emplace_back(storage.alloc_page());
+        TEST_ASSERT_EQ(page_ids.back(), static_cast<page_id_t>(i));
+    }
+
+    alignas(PAGE_SIZE) char buf[BATCH_PAGES][PAGE_SIZE];
+    std::vector<const char *> pages_data;
+    for (size_t i = 0; i < BATCH_PAGES; ++i) {
+        std::memset(buf[i], static_cast<int>(i + 1), PAGE_SIZE);
+        pages_data.emplace_back(buf[i]);
+    }
+    storage.write_pages(page_ids, pages_data);
+    std::memset(buf, 0, sizeof(buf));
+    std::vector<io::Storage::IoRequest> requests;
+    for (size_t i = 0; i < BATCH_PAGES; ++i) {
+        requests.push_back({page_ids[i], buf[i], false, false});
+    }
+    requests.push_back({UNALLOCATED_PAGE_ID, buf[0], false, true});
+    storage.wait(storage.submit(requests.data(), requests.size()));
+    for (size_t i = 0; i < BATCH_PAGES; ++i) {
+        TEST_ASSERT(requests[i].succeeded_);
+        TEST_ASSERT_EQ(buf[i][PAGE_SIZE - 1], static_cast<char>(i + 1));
+    }
+    TEST_ASSERT(!requests.back().succeeded_);
+
+    // freed pages are reused lowest first and read as zeros
+    storage.free_page(7);
+    storage.free_page(3);
+    TEST_ASSERT(!storage.page_allocated(3));
+    TEST_ASSERT_EQ(storage.allocated_pages(), BATCH_PAGES - 2);
+    bool failed = false;
+    try {
+        storage.read_page(3, buf[0]);
+    } catch (const IOException &) {
+        failed = true;
+    }
+    TEST_ASSERT(failed);
+    TEST_ASSERT_EQ(storage.alloc_page(), 3);
+    TEST_ASSERT_EQ(storage.alloc_page(), 7);
+    TEST_ASSERT_EQ(storage.alloc_page(), static_cast<page_id_t>(BATCH_PAGES));
+    storage.read_page(3, buf[0]);
+    TEST_ASSERT_EQ(buf[0][0], 0);
+}
+
+/**
+ * @brief Injected latency is paid once per call, and the bandwidth limit makes large transfers take longer.
+ *
+ */
+void test_delays() {
+    using std::chrono::milliseconds;
+    io::MemoryStorage storage({milliseconds(5), 0});
+    std::vector<page_id_t> page_ids;
+    std::vector<char *> pages_data;
+    alignas(PAGE_SIZE) char buf[BATCH_PAGES][PAGE_SIZE];
+    for (size_t i = 0; i < BATCH_PAGES; ++i) {
+        page_ids.emplace_back(storage.alloc_page());
+        pages_data.emplace_back(buf[i]);
+    }
+    auto start = std::chrono::steady_clock::now();
+    storage.read_page(0, buf[0]);
+    TEST_ASSERT(std::chrono::steady_clock::now() - start >= milliseconds(5));
+    start = std::chrono::steady_clock::now();
+    storage.read_pages(page_ids, pages_data);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    TEST_ASSERT(elapsed >= milliseconds(5) && elapsed < milliseconds(5) * BATCH_PAGES);
+
+    // 16 pages at 1 MB/s take 64 ms
+    io::MemoryStorage slow_storage({std::chrono::nanoseconds(0), 1 << 20});
+    for (size_t i = 0; i < BATCH_PAGES; ++i) {
+        slow_storage.alloc_page();
+    }
+    start = std::chrono::steady_clock::now();
+    slow_storage.read_pages(page_ids, pages_data);
+    TEST_ASSERT(std::chrono::steady_clock::now() - start >= milliseconds(60));
+}
+
+/**
+ * @brief The buffer manager works the same on top of memory, including evictions.
+ *
+ */
+void test_buffer_manager() {
+    io::MemoryStorage storage;
+    buffer::BufferManager bm(4, &storage);
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < BATCH_PAGES; ++i) {
+        auto page = bm.new_page();
+        TEST_ASSERT_NE(page, std::nullopt);
+        auto page_id = page->page_id();
+        std::memcpy(page->data_mut(), &page_id, sizeof(page_id));
+        page_ids.emplace_back(page_id);
+    }
+    for (auto page_id : page_ids) {
+        auto page = bm.fetch_page(page_id);
+        TEST_ASSERT_NE(page, std::nullopt);
+        TEST_ASSERT_EQ(std::memcmp(page->data(), &page_id, sizeof(page_id)), 0);
+    }
+    TEST_ASSERT(bm.delete_page(page_ids[0]));
+    TEST_ASSERT(!storage.page_allocated(page_ids[0]));
+    TEST_ASSERT_EQ(bm.fetch_page(page_ids[0]), std::nullopt);
+}
+
+int main() {
+    test_pages();
+    test_delays();
+    test_buffer_manager();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+#include "common/constants.h"
+#include "common/types.h"
+#include "io/disk_manager.h"
+#include "io/tablespace.h"
+#include "test_utils.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace naivedb;
+
+constexpr size_t FILES = 3;
+constexpr size_t PAGES = 30;
+
+const std::vector<std::string> FILE_NAMES = {"test_0.db", "test_1.db", "test_2.db"};
+
+void remove_files() {
+    for (const auto &file_name : FILE_NAMES) {
+        remove(file_name.c_str());
+    }
+}
+
+/**
+ * @brief Write the id of each page into the page, through the tablespace and batches of different sizes.
+ *
+ */
+void write_pages(io::Tablespace &tablespace, const std::vector<page_id_t> &page_ids) {
+    auto buf = static_cast<char *>(std::aligned_alloc(PAGE_SIZE, PAGES * PAGE_SIZE));
+    std::vector<const char *> pages_data;
+    for (size_t i = 0; i < PAGES; ++i) {
+        std::memset(buf + i * PAGE_SIZE, 0, PAGE_SIZE);
+        std::memcpy(buf + i * PAGE_SIZE, &page_ids[i], sizeof(page_id_t));
+        pages_data.emplace_back(buf + i * PAGE_SIZE);
+    }
+    tablespace.write_page(page_ids[0], pages_data[0]);
+    tablespace.write_pages(std::vector<page_id_t>(page_ids.begin() + 1, page_ids.begin() + PAGES / 2),
+                           std::vector<const char *>(pages_data.begin() + 1, pages_data.begin() + PAGES / 2));
+    std::vector<io::Tablespace::IoRequest> requests;
+    for (size_t i = PAGES / 2; i < PAGES; ++i) {
+        requests.push_back({page_ids[i], buf + i * PAGE_SIZE, true, false});
+    }
+    tablespace.wait(tablespace.submit(requests.data(), requests.size()));
+    for (auto &request : requests) {
+        TEST_ASSERT(request.succeeded_);
+    }
+    std::free(buf);
+}
+
+void check_pages(io::Tablespace &tablespace, const std::vector<page_id_t> &page_ids) {
+    auto buf = static_cast<char *>(std::aligned_alloc(PAGE_SIZE, PAGES * PAGE_SIZE));
+    std::memset(buf, 0xff, PAGES * PAGE_SIZE);
+    // read the pages in reverse order, half with read_pages() and half with submit()
+    std::vector<page_id_t> read_page_ids;
+    std::vector<char *> pages_data;
+    std::vector<io::Tablespace::IoRequest> requests;
+    for (size_t i = 0; i < PAGES; ++i) {
+        auto page_id = page_ids[PAGES - 1 - i];
+        if (i % 2 == 0) {
+            read_page_ids.emplace_back(page_id);
+            pages_data.emplace_back(buf + i * PAGE_SIZE);
+        } else {
+            requests.push_back({page_id, buf + i * PAGE_SIZE, false, false});
+        }
+    }
+    tablespace.read_pages(read_page_ids, pages_data);
+    tablespace.wait(tablespace.submit(requests.data(), requests.size()));
+    for (auto &request : requests) {
+        TEST_ASSERT(request.succeeded_);
+    }
+    for (size_t i = 0; i < PAGES; ++i) {
+        TEST_ASSERT_EQ(std::memcmp(buf + i * PAGE_SIZE, &page_ids[PAGES - 1 - i], sizeof(page_id_t)), 0);
+    }
+    char page[PAGE_SIZE];
+    tablespace.read_page(page_ids[1], page);
+    TEST_ASSERT_EQ(std::memcmp(page, &page_ids[1], sizeof(page_id_t)), 0);
+    std::free(buf);
+}
+
+void test_tablespace(io::IoBackend backend) {
+    remove_files();
+    std::vector<page_id_t> page_ids;
+    {
+        io::Tablespace tablespace(FILE_NAMES, backend);
+        TEST_ASSERT_EQ(tablespace.num_files(), FILES);
+        for (size_t i = 0; i < PAGES; ++i) {
+            page_ids.emplace_back(tablespace.alloc_page());
+        }
+        // consecutive allocations take turns among the files
+        for (size_t i = 0; i < PAGES; ++i) {
+            TEST_ASSERT_EQ(page_ids[i], static_cast<page_id_t>(i));
+        }
+        write_pages(tablespace, page_ids);
+        check_pages(tablespace, page_ids);
+    }
+    {
+        // the pages are striped over the files
+        io::DiskManager dm(FILE_NAMES[1]);
+        TEST_ASSERT(dm.page_allocated(PAGES / FILES - 1));
+        TEST_ASSERT(!dm.page_allocated(PAGES / FILES));
+        char page[PAGE_SIZE];
+        dm.read_page(0, page);
+        page_id_t page_id;
+        std::memcpy(&page_id, page, sizeof(page_id));
+        TEST_ASSERT_EQ(page_id, 1);
+    }
+    io::Tablespace tablespace(FILE_NAMES, backend);
+    check_pages(tablespace, page_ids);
+    tablespace.free_page(4);
+    TEST_ASSERT(!tablespace.page_allocated(4));
+    TEST_ASSERT(tablespace.page_allocated(5));
+    TEST_ASSERT(!tablespace.page_allocated(PAGES));
+    // a reopened tablespace starts with the first file, which has no free page before its last one
+    TEST_ASSERT_EQ(tablespace.alloc_page(), 30);
+    TEST_ASSERT_EQ(tablespace.alloc_page(), 4);
+    remove_files();
+}
+
+int main() {
+    test_tablespace(io::IoBackend::Sync);
+    test_tablespace(io::IoBackend::IoUring);
+    return EXIT_SUCCESS;
+}
@@ -3,15 +3,19 @@
 #include "common/types.h"
 #include "io/disk_manager.h"
 #include "storage/table/table_heap.h"
+#include "storage/table/table_page.h"
 #include "storage/tuple/tuple.h"
 #include "storage/tuple/tuple_id.h"
 #include "test_utils.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <fmt/core.h>
 #include <iostream>
+#include <optional>
 #include <random>
+#include <thread>
 
 using namespace naivedb;
 
@@ -207,5 +211,117 @@ int main() {
         TEST_ASSERT_EQ(validate_crc_sum, crc_sum);
     }
 
+    fmt::print("14. drop a table and compact another one...\n");
+    {
+        io::DiskManager dm("test.db");
+        buffer::BufferManager bm(8, &dm);
+        storage::TableHeap table(&bm, root_page_id);
+        // the pages of the two tables are interleaved
+        storage::TableHeap dropped_table(&bm);
+        for (size_t i = 0; i < TUPLE_COUNT; ++i) {
+            TEST_ASSERT_NE(dropped_table.insert_tuple(storage::Tuple(generate_random_data(rng, MAX_DATASIZE))),
+                           INVALID_TUPLE_ID);
+            TEST_ASSERT_NE(table.insert_tuple(tuples[i]), INVALID_TUPLE_ID);
+        }
+        crc_sum *= 2;
+        {
+            // a pinned page stops the drop, and becomes the root of the pages left
+            auto root_page_id = dropped_table.root_page_id();
+            auto root_page = bm.fetch_page(root_page_id);
+            TEST_ASSERT_NE(root_page, std::nullopt);
+            auto second_page_id = storage::TablePage(*std::move(root_page)).next_page_id();
+            auto second_page = bm.fetch_page(second_page_id);
+            TEST_ASSERT_NE(second_page, std::nullopt);
+            TEST_ASSERT(!dropped_table.drop());
+            TEST_ASSERT(!bm.page_allocated(root_page_id));
+            TEST_ASSERT_EQ(dropped_table.root_page_id(), second_page_id);
+            TEST_ASSERT_EQ(storage::TablePage(*std::move(second_page)).prev_page_id(), INVALID_PAGE_ID);
+        }
+        TEST_ASSERT(dropped_table.drop());
+        bm.flush_all_pages();
+        // the pages of the dropped table are all followed by pages of the other table
+        dm.truncate_free_tail();
+
+        storage::CompactionOptions options;
+        size_t progress_calls = 0;
+        options.on_progress_ = [&](const storage::CompactionProgress &) { ++progress_calls; };
+        storage::CompactionProgress progress;
+        TEST_ASSERT(table.compact(options, progress));
+        TEST_ASSERT_EQ(progress_calls, progress.pages_visited_);
+        TEST_ASSERT(progress.pages_moved_ > 0);
+        bm.flush_all_pages();
+        TEST_ASSERT(bm.truncate_free_tail() > 0);
+
+        uint32_t validate_crc_sum = 0;
+        size_t tuple_count = 0;
+        for (auto tuple : table) {
+            validate_crc_sum += crc32(tuple.data().data(), tuple.size());
+            ++tuple_count;
+        }
+        TEST_ASSERT_EQ(tuple_count, 2 * TUPLE_COUNT);
+        TEST_ASSERT_EQ(validate_crc_sum, crc_sum);
+    }
+
+    fmt::print("15. read the table optimistically while it is being modified...\n");
+    {
+        constexpr size_t TUPLE_SIZE = 1024;
+        constexpr size_t HOT_TUPLES = 4;
+        constexpr size_t READERS = 4;
+        constexpr size_t ROUNDS = 20000;
+        // the tuples of each version are filled with one byte, so a torn read shows up as a mixed tuple
+        auto uniform_tuple = [](char c) { return storage::Tuple(std::vector<char>(TUPLE_SIZE, c)); };
+        auto is_uniform = [](const storage::Tuple &tuple) {
+            return std::all_of(tuple.data().begin(), tuple.data().end(), [&](char c) { return c == tuple.data()[0]; });
+        };
+
+        io::DiskManager dm("test.db");
+        buffer::BufferManager bm(64, &dm);
+        storage::TableHeap table(&bm);
+        std::vector<tuple_id_t> ids(TUPLE_COUNT);
+        for (size_t i = 0; i < TUPLE_COUNT; ++i) {
+            ids[i] = table.insert_tuple(uniform_tuple(0));
+            TEST_ASSERT_NE(ids[i], INVALID_TUPLE_ID);
+        }
+
+        std::atomic<bool> stop = false;
+        std::vector<std::thread> readers;
+        for (size_t r = 0; r < READERS; ++r) {
+            readers.emplace_back([&, r]() {
+                for (size_t n = r; !stop.load(); ++n) {
+                    auto tuple = table.get_tuple(ids[n % HOT_TUPLES]);
+                    TEST_ASSERT_NE(tuple, std::nullopt);
+                    TEST_ASSERT(is_uniform(*tuple));
+                    if (n % 64 != 0) {
+                        continue;
+                    }
+                    size_t tuple_count = 0;
+                    for (auto iter_tuple : table) {
+                        TEST_ASSERT(is_uniform(iter_tuple));
+                        ++tuple_count;
+                    }
+                    TEST_ASSERT(tuple_count >= TUPLE_COUNT);
+                }
+            });
+        }
+        // the writer updates the hot tuples in place, and inserts and deletes other tuples to move the tuples around
+        for (size_t round = 0; round < ROUNDS; ++round) {
+            auto c = static_cast<char>(round);
+            TEST_ASSERT(table.update_tuple(ids[round % HOT_TUPLES], uniform_tuple(c)));
+            auto extra_id = table.insert_tuple(uniform_tuple(c));
+            TEST_ASSERT_NE(extra_id, INVALID_TUPLE_ID);
+            table.delete_tuple(extra_id);
+        }
+        stop.store(true);
+        for (auto &reader : readers) {
+            reader.join();
+        }
+        for (size_t i = 0; i < TUPLE_COUNT; ++i) {
+            auto tuple = table.get_tuple(ids[i]);
+            TEST_ASSERT_NE(tuple, std::nullopt);
+            TEST_ASSERT(is_uniform(*tuple));
+        }
+    }
+
+    remove("test.db");
     return EXIT_SUCCESS;
 }
\ No newline at end of file